@@ -0,0 +1,153 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file poslv_framing_check.cpp
+    \brief This file checks that the framed TCP connection client splits and
+           resynchronizes the byte stream into packets.
+  */
+
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+
+#include <libposlv/exceptions/IOException.h>
+
+#include "FramedTCPConnectionClient.h"
+
+namespace {
+
+  /// Number of failed checks
+  size_t numFailures = 0;
+
+  /// Reports a failed check
+  void check(bool condition, const std::string& message) {
+    if (!condition) {
+      std::cerr << "FAILED: " << message << std::endl;
+      numFailures++;
+    }
+  }
+
+  /// Returns a packet with a start, an ID and a payload
+  std::string frame(const std::string& start, uint16_t id,
+      const std::string& payload) {
+    std::string bytes(start);
+    bytes.push_back(static_cast<char>(id & 0xff));
+    bytes.push_back(static_cast<char>(id >> 8));
+    bytes.push_back(static_cast<char>(payload.size() & 0xff));
+    bytes.push_back(static_cast<char>(payload.size() >> 8));
+    return bytes + payload;
+  }
+
+  /// Client fed from memory instead of the socket
+  class MemoryClient :
+    public poslv::FramedTCPConnectionClient {
+  public:
+    /// Constructor
+    MemoryClient() :
+        FramedTCPConnectionClient("127.0.0.1", 0) {
+    }
+    /// Appends received bytes
+    void push(const std::string& bytes) {
+      if (_end + bytes.size() > _buffer.size())
+        _buffer.resize(_end + bytes.size());
+      bytes.copy(&_buffer[_end], bytes.size());
+      _end += bytes.size();
+    }
+    /// Returns the buffer size
+    size_t getBufferSize() const {
+      return _buffer.size();
+    }
+    /// Reads the rest of the current packet
+    std::string readAll(size_t numBytes) {
+      std::string bytes(numBytes, '\0');
+      read(&bytes[0], numBytes);
+      return bytes;
+    }
+  };
+
+}
+
+int main(int /*argc*/, char** /*argv*/) {
+  typedef poslv::FramedTCPConnectionClient Client;
+  {
+    // leading garbage is skipped, packets are served one by one
+    MemoryClient client;
+    const std::string first = frame("$GRP", 1, "abcd");
+    const std::string second = frame("$MSG", 2, "xy");
+    client.push("zz$GR" + first + second.substr(0, 5));
+    check(client.nextFrame(), "first packet framed");
+    check(client.getNumDiscardedBytes() == 5, "garbage discarded");
+    check(client.readAll(first.size()) == first, "first packet bytes");
+    bool overrun = false;
+    try {
+      client.readAll(1);
+    }
+    catch (const IOException& e) {
+      overrun = true;
+    }
+    check(overrun, "read past packet boundary rejected");
+    check(!client.nextFrame(), "incomplete packet held back");
+    client.push(second.substr(5));
+    check(client.nextFrame(), "completed packet framed");
+    check(client.readAll(4) == "$MSG", "packet read partially");
+    check(!client.nextFrame(), "partial packet discarded");
+    check(client.getNumFrames() == 2, "number of packets");
+  }
+  {
+    // a false start announcing a long packet must not swallow the packets
+    // it spans once it is rejected
+    MemoryClient client;
+    const std::string valid = frame("$GRP", 3, "payload");
+    std::string bytes = frame("$GRP", 9, std::string(3 * valid.size(), 'q'));
+    bytes.replace(8, 3 * valid.size(), valid + valid + valid);
+    client.push(bytes);
+    check(client.nextFrame(), "false packet framed");
+    client.rejectFrame();
+    check(client.getNumRejectedFrames() == 1, "false packet rejected");
+    size_t numValid = 0;
+    while (client.nextFrame()) {
+      check(client.readAll(valid.size()) == valid, "spanned packet bytes");
+      numValid++;
+    }
+    check(numValid == 3, "spanned packets recovered");
+  }
+  {
+    // resizing keeps the buffered bytes and never drops below a packet
+    MemoryClient client;
+    const std::string valid = frame("$GRP", 4, "1234");
+    client.push("noise" + valid + valid.substr(0, 6));
+    check(client.nextFrame(), "packet framed before resizing");
+    client.setBufferSize(16);
+    check(client.getBufferSize() == Client::maxFrameSize,
+      "buffer not below a packet");
+    check(client.readAll(valid.size()) == valid, "packet kept by resizing");
+    client.push(valid.substr(6));
+    check(client.nextFrame() && client.readAll(valid.size()) == valid,
+      "partial packet kept by resizing");
+    client.setBufferSize(2 * Client::maxFrameSize);
+    check(client.getBufferSize() == 2 * Client::maxFrameSize,
+      "buffer grown");
+  }
+  if (numFailures) {
+    std::cerr << numFailures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Packet framing passed" << std::endl;
+  return 0;
+}
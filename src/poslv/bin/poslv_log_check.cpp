@@ -0,0 +1,246 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file poslv_log_check.cpp
+    \brief This file checks that columnar logs read back what was written.
+  */
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include "ColumnarLogFormat.h"
+#include "ColumnarLogWriter.h"
+#include "ColumnarLogReader.h"
+
+namespace {
+
+  /// Number of failed checks
+  size_t numFailures = 0;
+
+  /// Reports a failed check
+  void check(bool condition, const std::string& message) {
+    if (!condition) {
+      std::cerr << "FAILED: " << message << std::endl;
+      numFailures++;
+    }
+  }
+
+  /// Value of a test row
+  int64_t rowValue(size_t row, size_t column) {
+    switch (column) {
+      case 1:
+        return row % 5 ? std::numeric_limits<int64_t>::max() :
+          std::numeric_limits<int64_t>::min();
+      case 2:
+        return row < 50 ? 3 : -3;
+      default:
+        return row * 1000;
+    }
+  }
+
+  /// Real value of a test row
+  double realValue(size_t row) {
+    if (row == 10)
+      return std::numeric_limits<double>::quiet_NaN();
+    if (row == 11)
+      return -std::numeric_limits<double>::infinity();
+    return 47.0 + row * 1e-7;
+  }
+
+  /// Compares two doubles bit for bit
+  bool sameBits(double first, double second) {
+    return !std::memcmp(&first, &second, sizeof(first));
+  }
+
+  /// Encodes and decodes a block, returns the encoded size
+  size_t roundTrip(const std::vector<int64_t>& values,
+      poslv::ColumnarLogColumn::Type type, const std::string& message) {
+    std::string block;
+    poslv::ColumnarLogFormat::encodeBlock(values, values.size(), type, block);
+    std::vector<int64_t> decoded;
+    check(poslv::ColumnarLogFormat::decodeBlock(block.data(), block.size(),
+      values.size(), type, decoded) && decoded == values, message);
+    return block.size();
+  }
+
+  /// Bit patterns of Gaussian noise around zero
+  std::vector<int64_t> noise(size_t numRows,
+      poslv::ColumnarLogColumn::Type type) {
+    std::vector<int64_t> values;
+    unsigned int seed = 1;
+    for (size_t i = 0; i < numRows; ++i) {
+      const double u1 = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+      const double u2 = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+      values.push_back(poslv::ColumnarLogFormat::toBits(0.05 *
+        std::sqrt(-2 * std::log(u1)) * std::cos(2 * M_PI * u2), type));
+    }
+    return values;
+  }
+
+}
+
+int main(int argc, char** argv) {
+  char directoryTemplate[] = "/tmp/poslv_log_check_XXXXXX";
+  const char* directory = argc > 1 ? argv[1] : mkdtemp(directoryTemplate);
+  if (!directory) {
+    std::cerr << "Cannot create a temporary directory" << std::endl;
+    return 1;
+  }
+  const size_t numRows = 100;
+  std::vector<std::string> filenames;
+  try {
+    typedef poslv::ColumnarLogColumn Column;
+    std::vector<Column> columns;
+    columns.push_back(Column("stamp", Column::integer));
+    columns.push_back(Column("extreme", Column::integer));
+    columns.push_back(Column("status", Column::integer, 1));
+    columns.push_back(Column("latitude", Column::float64));
+    columns.push_back(Column("speed", Column::float32));
+    {
+      poslv::ColumnarLogWriter writer(directory, 7, numRows);
+      const size_t table = writer.addTable("check", columns);
+      for (size_t i = 0; i < numRows; ++i) {
+        writer.beginRow(table);
+        writer.addInteger(rowValue(i, 0));
+        writer.addInteger(rowValue(i, 1));
+        writer.addInteger(rowValue(i, 2));
+        writer.addReal(realValue(i));
+        writer.addReal(static_cast<float>(i) * 0.1f);
+        writer.endRow();
+      }
+      bool overwritten = true;
+      try {
+        writer.addTable("check", columns);
+      }
+      catch (const std::exception& e) {
+        overwritten = false;
+      }
+      check(!overwritten, "existing file overwritten");
+    }
+    const std::string filename = std::string(directory) + "/check.col";
+    filenames.push_back(filename);
+    {
+      poslv::ColumnarLogReader reader(filename);
+      check(reader.getNumRows() == numRows, "number of rows");
+      check(reader.getNumChunks() == (numRows + 6) / 7, "number of chunks");
+      std::vector<std::string> names;
+      for (size_t j = 0; j < columns.size(); ++j)
+        names.push_back(columns[j].mName);
+      std::vector<double> times;
+      std::vector<std::vector<double> > values;
+      reader.readColumns(names, -1, 1, times, values);
+      check(times.size() == numRows, "rows of the full range");
+      for (size_t i = 0; i < times.size(); ++i) {
+        check(times[i] == rowValue(i, 0) * 1e-9, "time");
+        check(values[0][i] == rowValue(i, 0), "stamp column");
+        check(values[1][i] == static_cast<double>(rowValue(i, 1)),
+          "extreme column");
+        check(values[2][i] == rowValue(i, 2), "status column");
+        check(sameBits(values[3][i], realValue(i)), "float64 column");
+        check(values[4][i] == static_cast<float>(i) * 0.1f, "float32 column");
+      }
+      reader.readColumns(std::vector<std::string>(1, "status"), 20e-6,
+        29e-6, times, values);
+      check(times.size() == 10 && values[0].size() == 10, "time range");
+      check(!times.empty() && times.front() == 20e-6, "time range start");
+    }
+    {
+      // a corrupt chunk header must be ignored, not allocated
+      std::ofstream stream(filename.c_str(),
+        std::ios::out | std::ios::binary | std::ios::app);
+      std::string header("CHNK");
+      poslv::ColumnarLogFormat::writeUInt32(0xffffffff, header);
+      poslv::ColumnarLogFormat::writeInt64(0, header);
+      poslv::ColumnarLogFormat::writeInt64(0, header);
+      for (size_t j = 0; j < columns.size(); ++j)
+        poslv::ColumnarLogFormat::writeUInt32(1, header);
+      header.append(columns.size(), '\0');
+      stream.write(header.data(), header.size());
+    }
+    poslv::ColumnarLogReader reader(filename);
+    check(reader.getNumRows() == numRows, "corrupt chunk skipped");
+    std::vector<int64_t> decoded;
+    check(!poslv::ColumnarLogFormat::decodeBlock("\1", 1, 0xffffffff,
+      Column::integer, decoded), "oversized block rejected");
+    check(!poslv::ColumnarLogFormat::decodeBlock("\7", 1, 1,
+      Column::integer, decoded), "unknown encoding rejected");
+    std::vector<int64_t> raw;
+    for (size_t i = 0; i < numRows; ++i)
+      raw.push_back(rowValue(i, i % 3));
+    check(roundTrip(raw, Column::integer, "integer block round trip") <=
+      1 + 8 * raw.size(), "integer block not larger than raw");
+    // noise around zero defeats the varints, the shuffled bytes must not
+    // be larger than the raw values
+    const size_t numNoisyRows = 4096;
+    check(roundTrip(noise(numNoisyRows, Column::float32), Column::float32,
+      "float32 block round trip") < 4 * numNoisyRows,
+      "float32 noise smaller than raw");
+    check(roundTrip(noise(numNoisyRows, Column::float64), Column::float64,
+      "float64 block round trip") < 8 * numNoisyRows,
+      "float64 noise smaller than raw");
+    {
+      // a partial chunk older than the flush period is readable while the
+      // writer is still open
+      poslv::ColumnarLogWriter writer(directory, 4096, 16, 0.01);
+      const size_t table = writer.addTable("flush", columns);
+      filenames.push_back(std::string(directory) + "/flush.col");
+      writer.beginRow(table);
+      for (size_t j = 0; j < columns.size(); ++j)
+        writer.addInteger(0);
+      writer.endRow();
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      writer.flushExpired();
+      size_t numFlushedRows = 0;
+      for (size_t i = 0; i < 100 && !numFlushedRows; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        numFlushedRows = writer.getNumRows();
+      }
+      check(numFlushedRows == 1, "expired chunk queued");
+      poslv::ColumnarLogReader flushed(filenames.back());
+      check(flushed.getNumRows() == 1, "expired chunk readable");
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Exception: " << e.what() << std::endl;
+    return 1;
+  }
+  if (numFailures) {
+    std::cerr << numFailures << " checks failed in " << directory
+      << std::endl;
+    return 1;
+  }
+  if (argc <= 1) {
+    for (size_t i = 0; i < filenames.size(); ++i)
+      ::unlink(filenames[i].c_str());
+    ::rmdir(directory);
+  }
+  std::cout << "Columnar log round trip passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file poslv_log_reader.cpp
+    \brief This file is a tool for extracting fields from columnar logs.
+  */
+
+#include <cstdlib>
+
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ColumnarLogReader.h"
+
+int main(int argc, char** argv) {
+  if (argc != 2 && argc != 3 && argc != 5) {
+    std::cerr << "Usage: " << argv[0] << " <LOG_FILE> [<FIELD>[,<FIELD>...] "
+      "[<START_TIME> <END_TIME>]]" << std::endl;
+    return 1;
+  }
+  try {
+    poslv::ColumnarLogReader reader(argv[1]);
+    if (argc == 2) {
+      std::cout << std::fixed << std::setprecision(9)
+        << "rows: " << reader.getNumRows() << std::endl
+        << "chunks: " << reader.getNumChunks() << std::endl
+        << "start time [s]: " << reader.getStartTime() << std::endl
+        << "end time [s]: " << reader.getEndTime() << std::endl
+        << "fields:" << std::endl;
+      const std::vector<poslv::ColumnarLogColumn>& columns =
+        reader.getColumns();
+      for (auto it = columns.cbegin(); it != columns.cend(); ++it)
+        std::cout << "  " << it->mName << std::endl;
+      return 0;
+    }
+    std::vector<std::string> names;
+    std::istringstream fields(argv[2]);
+    std::string name;
+    while (std::getline(fields, name, ','))
+      names.push_back(name);
+    double startTime = -std::numeric_limits<double>::max();
+    double endTime = std::numeric_limits<double>::max();
+    if (argc == 5) {
+      startTime = std::atof(argv[3]);
+      endTime = std::atof(argv[4]);
+    }
+    std::vector<double> times;
+    std::vector<std::vector<double> > values;
+    reader.readColumns(names, startTime, endTime, times, values);
+    std::cout << "time";
+    for (auto it = names.cbegin(); it != names.cend(); ++it)
+      std::cout << "," << *it;
+    std::cout << std::endl << std::setprecision(17);
+    for (size_t i = 0; i < times.size(); ++i) {
+      std::cout << times[i];
+      for (size_t j = 0; j < values.size(); ++j)
+        std::cout << "," << values[j][i];
+      std::cout << "\n";
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Exception: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,143 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file poslv_quality_check.cpp
+    \brief This file checks the rolling statistics and the navigation quality
+           residuals.
+  */
+
+#include <cmath>
+
+#include <iostream>
+#include <limits>
+#include <string>
+#include <deque>
+
+#include <libposlv/types/VehicleNavigationSolution.h>
+
+#include "RollingStatistics.h"
+#include "NavigationQualityMonitor.h"
+
+namespace {
+
+  /// Number of failed checks
+  size_t numFailures = 0;
+
+  /// Reports a failed check
+  void check(bool condition, const std::string& message) {
+    if (!condition) {
+      std::cerr << "FAILED: " << message << std::endl;
+      numFailures++;
+    }
+  }
+
+  /// Checks that two values are close
+  void checkClose(double value, double expected, const std::string& message) {
+    check(std::fabs(value - expected) <= 1e-9 * (1 + std::fabs(expected)),
+      message);
+  }
+
+}
+
+int main(int /*argc*/, char** /*argv*/) {
+  {
+    // the running sums must match the window after many wraps
+    const size_t windowSize = 7;
+    poslv::RollingStatistics statistics(windowSize);
+    std::deque<double> window;
+    for (size_t i = 0; i < 1000; ++i) {
+      const double value = 1e3 + std::sin(0.1 * i) * (i % 3 ? 1 : -2);
+      statistics.addSample(value);
+      window.push_back(value);
+      if (window.size() > windowSize)
+        window.pop_front();
+      double sum = 0;
+      double squaredSum = 0;
+      for (auto it = window.cbegin(); it != window.cend(); ++it) {
+        sum += *it;
+        squaredSum += *it * *it;
+      }
+      const double mean = sum / window.size();
+      check(statistics.getNumSamples() == window.size(), "number of samples");
+      checkClose(statistics.getLast(), value, "last sample");
+      checkClose(statistics.getMean(), mean, "mean");
+      checkClose(statistics.getRMS(), std::sqrt(squaredSum / window.size()),
+        "root mean square");
+      check(std::fabs(statistics.getVariance() - (squaredSum /
+        window.size() - mean * mean)) < 1e-6, "variance");
+    }
+    check(!statistics.hasRejectedSamples(), "no rejected samples");
+    statistics.setWindowSize(3);
+    check(!statistics.getNumSamples() && statistics.getRMS() == 0,
+      "resizing clears the window");
+  }
+  {
+    // non-finite samples are rejected and flagged for one window
+    poslv::RollingStatistics statistics(3);
+    statistics.addSample(1);
+    statistics.addSample(std::numeric_limits<double>::quiet_NaN());
+    statistics.addSample(std::numeric_limits<double>::infinity());
+    check(statistics.getNumSamples() == 1, "non-finite samples rejected");
+    check(statistics.getNumRejectedSamples() == 2, "rejected samples counted");
+    check(statistics.getRMS() == 1 && statistics.getMean() == 1,
+      "statistics unaffected by rejected samples");
+    check(statistics.hasRejectedSamples(), "rejection flagged");
+    for (size_t i = 0; i < 3; ++i)
+      statistics.addSample(2);
+    check(!statistics.hasRejectedSamples(), "rejection expired");
+  }
+  {
+    // reversing while speeding up backwards is consistent
+    poslv::NavigationQualityMonitor monitor(50, 10, 1);
+    VehicleNavigationSolution vns;
+    vns.mTimeDistance.mTime2 = 0;
+    vns.mLatitude = 47;
+    vns.mLongitude = 8;
+    vns.mAltitude = 400;
+    vns.mNorthVelocity = 0;
+    vns.mEastVelocity = 0;
+    vns.mDownVelocity = 0;
+    vns.mRoll = 0;
+    vns.mPitch = 0;
+    vns.mHeading = 0;
+    vns.mAngularRateTrans = 0;
+    vns.mAngularRateDown = 0;
+    vns.mAccLong = -0.5;
+    const double dt = 0.01;
+    const double metersPerDegree = 111157;
+    for (size_t i = 0; i < 200; ++i) {
+      const double time = i * dt;
+      vns.mTimeDistance.mTime2 = time;
+      vns.mNorthVelocity = -0.5 * time;
+      vns.mSpeed = std::fabs(vns.mNorthVelocity);
+      vns.mLatitude = 47 - 0.25 * time * time / metersPerDegree;
+      monitor.addSolution(vns);
+    }
+    check(monitor.getAccelerationResidual().getNumSamples() == 50,
+      "acceleration residuals");
+    check(monitor.getAccelerationResidual().getRMS() < 1e-3,
+      "reversing acceleration residual");
+    check(!monitor.hasRejectedSamples(), "no rejected residuals");
+  }
+  if (numFailures) {
+    std::cerr << numFailures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "Navigation quality passed" << std::endl;
+  return 0;
+}
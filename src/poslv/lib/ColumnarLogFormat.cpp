@@ -0,0 +1,311 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+#include "ColumnarLogFormat.h"
+
+#include <cstring>
+
+#include <zlib.h>
+
+namespace poslv {
+
+/******************************************************************************/
+/* Methods                                                                    */
+/******************************************************************************/
+
+  int64_t ColumnarLogFormat::toBits(double value,
+      ColumnarLogColumn::Type type) {
+    switch (type) {
+      case ColumnarLogColumn::float32: {
+        const float single = value;
+        int32_t bits;
+        std::memcpy(&bits, &single, sizeof(bits));
+        return bits;
+      }
+      case ColumnarLogColumn::float64: {
+        int64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+      }
+      default:
+        return static_cast<int64_t>(value);
+    }
+  }
+
+  double ColumnarLogFormat::fromBits(int64_t bits,
+      ColumnarLogColumn::Type type) {
+    switch (type) {
+      case ColumnarLogColumn::float32: {
+        const int32_t singleBits = static_cast<int32_t>(bits);
+        float value;
+        std::memcpy(&value, &singleBits, sizeof(value));
+        return value;
+      }
+      case ColumnarLogColumn::float64: {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+      }
+      default:
+        return static_cast<double>(bits);
+    }
+  }
+
+  void ColumnarLogFormat::writeVarint(uint64_t value, std::string& buffer) {
+    do {
+      uint8_t byte = value & 0x7f;
+      value >>= 7;
+      if (value)
+        byte |= 0x80;
+      buffer.push_back(static_cast<char>(byte));
+    } while (value);
+  }
+
+  bool ColumnarLogFormat::readVarint(const char* buffer, size_t size,
+      size_t& pos, uint64_t& value) {
+    value = 0;
+    for (size_t shift = 0; shift < 64; shift += 7) {
+      if (pos >= size)
+        return false;
+      const uint8_t byte = static_cast<uint8_t>(buffer[pos++]);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  size_t ColumnarLogFormat::getWidth(ColumnarLogColumn::Type type) {
+    return type == ColumnarLogColumn::float32 ? 4 : 8;
+  }
+
+  int64_t ColumnarLogFormat::fromWidth(uint64_t bits, size_t width) {
+    if (width == 4)
+      return static_cast<int32_t>(static_cast<uint32_t>(bits));
+    return static_cast<int64_t>(bits);
+  }
+
+  void ColumnarLogFormat::encodeBlock(const std::vector<int64_t>& values,
+      size_t numRows, ColumnarLogColumn::Type type, std::string& block) {
+    const size_t width = getWidth(type);
+    block.assign(1, static_cast<char>(varint));
+    encodeVarint(values, numRows, block);
+    std::string candidate(1, static_cast<char>(shuffle));
+    if (encodeShuffle(values, numRows, width, false, candidate) &&
+        candidate.size() < block.size())
+      block.swap(candidate);
+    candidate.assign(1, static_cast<char>(xorShuffle));
+    if (encodeShuffle(values, numRows, width, true, candidate) &&
+        candidate.size() < block.size())
+      block.swap(candidate);
+    if (block.size() > 1 + numRows * width) {
+      block.assign(1, static_cast<char>(raw));
+      encodeRaw(values, numRows, width, block);
+    }
+  }
+
+  bool ColumnarLogFormat::decodeBlock(const char* block, size_t size,
+      size_t numRows, ColumnarLogColumn::Type type,
+      std::vector<int64_t>& values) {
+    if (numRows > maxChunkRows || !size)
+      return false;
+    const size_t width = getWidth(type);
+    switch (static_cast<uint8_t>(block[0])) {
+      case raw:
+        return decodeRaw(block + 1, size - 1, numRows, width, values);
+      case varint:
+        return decodeVarint(block + 1, size - 1, numRows, values);
+      case shuffle:
+        return decodeShuffle(block + 1, size - 1, numRows, width, false,
+          values);
+      case xorShuffle:
+        return decodeShuffle(block + 1, size - 1, numRows, width, true,
+          values);
+      default:
+        return false;
+    }
+  }
+
+  void ColumnarLogFormat::encodeRaw(const std::vector<int64_t>& values,
+      size_t numRows, size_t width, std::string& block) {
+    for (size_t i = 0; i < numRows; ++i) {
+      const uint64_t bits = static_cast<uint64_t>(values[i]);
+      for (size_t k = 0; k < width; ++k)
+        block.push_back(static_cast<char>((bits >> (8 * k)) & 0xff));
+    }
+  }
+
+  bool ColumnarLogFormat::decodeRaw(const char* block, size_t size,
+      size_t numRows, size_t width, std::vector<int64_t>& values) {
+    if (size != numRows * width)
+      return false;
+    values.resize(numRows);
+    for (size_t i = 0; i < numRows; ++i) {
+      uint64_t bits = 0;
+      for (size_t k = 0; k < width; ++k)
+        bits |= static_cast<uint64_t>(static_cast<uint8_t>(
+          block[i * width + k])) << (8 * k);
+      values[i] = fromWidth(bits, width);
+    }
+    return true;
+  }
+
+  void ColumnarLogFormat::encodeVarint(const std::vector<int64_t>& values,
+      size_t numRows, std::string& block) {
+    int64_t previous = 0;
+    size_t i = 0;
+    while (i < numRows) {
+      const uint64_t delta = static_cast<uint64_t>(values[i]) -
+        static_cast<uint64_t>(previous);
+      const uint64_t zigzag = (delta << 1) ^
+        static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63);
+      previous = values[i++];
+      writeVarint(zigzag, block);
+      // a zero delta is followed by the number of extra repetitions
+      if (!zigzag) {
+        uint64_t run = 0;
+        while (i < numRows && values[i] == previous) {
+          run++;
+          i++;
+        }
+        writeVarint(run, block);
+      }
+    }
+  }
+
+  bool ColumnarLogFormat::decodeVarint(const char* block, size_t size,
+      size_t numRows, std::vector<int64_t>& values) {
+    values.resize(numRows);
+    int64_t previous = 0;
+    size_t pos = 0;
+    size_t i = 0;
+    while (i < numRows) {
+      uint64_t zigzag;
+      if (!readVarint(block, size, pos, zigzag))
+        return false;
+      const uint64_t delta = (zigzag >> 1) ^ (0 - (zigzag & 1));
+      previous = static_cast<int64_t>(static_cast<uint64_t>(previous) +
+        delta);
+      values[i++] = previous;
+      if (!zigzag) {
+        uint64_t run;
+        if (!readVarint(block, size, pos, run) || run > numRows - i)
+          return false;
+        for (; run; --run)
+          values[i++] = previous;
+      }
+    }
+    return pos == size;
+  }
+
+  bool ColumnarLogFormat::encodeShuffle(const std::vector<int64_t>& values,
+      size_t numRows, size_t width, bool xorPrevious, std::string& block) {
+    // byte k of every value is stored in plane k, so that the rarely
+    // changing sign, exponent and high mantissa bytes form long runs
+    std::vector<Bytef> planes(numRows * width);
+    uint64_t previous = 0;
+    for (size_t i = 0; i < numRows; ++i) {
+      const uint64_t bits = static_cast<uint64_t>(values[i]);
+      const uint64_t stored = xorPrevious ? bits ^ previous : bits;
+      previous = bits;
+      for (size_t k = 0; k < width; ++k)
+        planes[k * numRows + i] = (stored >> (8 * k)) & 0xff;
+    }
+    uLongf size = compressBound(planes.size());
+    const size_t offset = block.size();
+    block.resize(offset + size);
+    if (compress2(reinterpret_cast<Bytef*>(&block[offset]), &size,
+        planes.data(), planes.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+      return false;
+    block.resize(offset + size);
+    return true;
+  }
+
+  bool ColumnarLogFormat::decodeShuffle(const char* block, size_t size,
+      size_t numRows, size_t width, bool xorPrevious,
+      std::vector<int64_t>& values) {
+    std::vector<Bytef> planes(numRows * width);
+    uLongf planesSize = planes.size();
+    if (uncompress(planes.data(), &planesSize,
+        reinterpret_cast<const Bytef*>(block), size) != Z_OK ||
+        planesSize != planes.size())
+      return false;
+    values.resize(numRows);
+    uint64_t previous = 0;
+    for (size_t i = 0; i < numRows; ++i) {
+      uint64_t bits = 0;
+      for (size_t k = 0; k < width; ++k)
+        bits |= static_cast<uint64_t>(planes[k * numRows + i]) << (8 * k);
+      if (xorPrevious)
+        bits ^= previous;
+      previous = bits;
+      values[i] = fromWidth(bits, width);
+    }
+    return true;
+  }
+
+  void ColumnarLogFormat::encodeHeader(const std::vector<ColumnarLogColumn>&
+      columns, std::string& header) {
+    header.assign("PLVC");
+    writeUInt32(version, header);
+    writeUInt32(columns.size(), header);
+    for (auto it = columns.cbegin(); it != columns.cend(); ++it) {
+      writeUInt16(it->mName.size(), header);
+      header.append(it->mName);
+      header.push_back(static_cast<char>(it->mType));
+    }
+  }
+
+  void ColumnarLogFormat::writeUInt16(uint16_t value, std::string& buffer) {
+    for (size_t i = 0; i < 2; ++i)
+      buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+
+  void ColumnarLogFormat::writeUInt32(uint32_t value, std::string& buffer) {
+    for (size_t i = 0; i < 4; ++i)
+      buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+
+  void ColumnarLogFormat::writeInt64(int64_t value, std::string& buffer) {
+    const uint64_t bits = static_cast<uint64_t>(value);
+    for (size_t i = 0; i < 8; ++i)
+      buffer.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+  }
+
+  uint16_t ColumnarLogFormat::readUInt16(const char* buffer) {
+    return static_cast<uint8_t>(buffer[0]) |
+      (static_cast<uint16_t>(static_cast<uint8_t>(buffer[1])) << 8);
+  }
+
+  uint32_t ColumnarLogFormat::readUInt32(const char* buffer) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i)
+      value |= static_cast<uint32_t>(static_cast<uint8_t>(buffer[i])) <<
+        (8 * i);
+    return value;
+  }
+
+  int64_t ColumnarLogFormat::readInt64(const char* buffer) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i)
+      value |= static_cast<uint64_t>(static_cast<uint8_t>(buffer[i])) <<
+        (8 * i);
+    return static_cast<int64_t>(value);
+  }
+
+}
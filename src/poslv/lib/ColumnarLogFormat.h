@@ -0,0 +1,179 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file ColumnarLogFormat.h
+    \brief This file defines the ColumnarLogFormat class which encodes the
+           columnar log files.
+  */
+
+#ifndef COLUMNAR_LOG_FORMAT_H
+#define COLUMNAR_LOG_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+namespace poslv {
+
+  /** The struct ColumnarLogColumn describes a column of a columnar log.
+      \brief Columnar log column
+    */
+  struct ColumnarLogColumn {
+    /// Column types, values are stored as their bit patterns
+    enum Type {
+      /// Signed integer
+      integer = 0,
+      /// Single precision floating point
+      float32 = 1,
+      /// Double precision floating point
+      float64 = 2
+    };
+    /// Constructor, a null raw size defaults to the width of the type
+    ColumnarLogColumn(const std::string& name = "", Type type = integer,
+        size_t rawSize = 0) :
+        mName(name),
+        mType(type),
+        mRawSize(rawSize ? rawSize : (type == float32 ? 4 : 8)) {
+    }
+    /// Column name
+    std::string mName;
+    /// Column type
+    Type mType;
+    /// Width of the source field in bytes, not stored in the file
+    size_t mRawSize;
+  };
+
+  /** The class ColumnarLogFormat encodes and decodes columnar log files.
+      A file starts with a header holding the magic "PLVC", the version and
+      the column descriptions. It is followed by chunks made of a header
+      holding the magic "CHNK", the number of rows, the time range of the
+      first column and the size of each column block, and of the column
+      blocks, so that a single column of a chunk can be decoded without
+      touching the others. A block starts with its encoding, the writer
+      keeps the smallest of the raw values, the delta, zigzag and varint
+      encoding with runs of unchanged values collapsed, and the deflated
+      bytes of the values, or of their XOR with the previous value,
+      shuffled by significance. Noisy real values compress better with the
+      latter while counters and slow values suit the varints, and no block
+      is larger than the raw values and its encoding byte. All the integers
+      are little endian.
+      \brief Columnar log format
+    */
+  class ColumnarLogFormat {
+  public:
+    /** \name Types definitions
+      @{
+      */
+    /// Block encodings, stored in the first byte of a block
+    enum Encoding {
+      /// Values with the width of the column
+      raw = 0,
+      /// Delta, zigzag and varint with runs of unchanged values
+      varint = 1,
+      /// Deflated bytes of the values shuffled by significance
+      shuffle = 2,
+      /// Deflated bytes of the XOR with the previous value, shuffled
+      xorShuffle = 3
+    };
+    /** @}
+      */
+
+    /** \name Constants
+      @{
+      */
+    /// Format version
+    static const uint32_t version = 2;
+    /// Size of the chunk header without the block sizes
+    static const size_t chunkHeaderSize = 4 + 4 + 8 + 8;
+    /// Maximum number of rows in a chunk, runs make rows smaller than a byte
+    static const size_t maxChunkRows = 1 << 20;
+    /** @}
+      */
+
+    /** \name Methods
+      @{
+      */
+    /// Converts a double to the stored bit pattern of a column
+    static int64_t toBits(double value, ColumnarLogColumn::Type type);
+    /// Converts a stored bit pattern of a column back to a double
+    static double fromBits(int64_t bits, ColumnarLogColumn::Type type);
+    /// Returns the stored width of a column type in bytes
+    static size_t getWidth(ColumnarLogColumn::Type type);
+    /// Encodes a column block with its smallest encoding
+    static void encodeBlock(const std::vector<int64_t>& values,
+      size_t numRows, ColumnarLogColumn::Type type, std::string& block);
+    /// Decodes a column block, returns false if it is corrupted
+    static bool decodeBlock(const char* block, size_t size, size_t numRows,
+      ColumnarLogColumn::Type type, std::vector<int64_t>& values);
+    /// Encodes the file header
+    static void encodeHeader(const std::vector<ColumnarLogColumn>& columns,
+      std::string& header);
+    /// Appends a little endian 16 bit integer
+    static void writeUInt16(uint16_t value, std::string& buffer);
+    /// Appends a little endian 32 bit integer
+    static void writeUInt32(uint32_t value, std::string& buffer);
+    /// Appends a little endian 64 bit integer
+    static void writeInt64(int64_t value, std::string& buffer);
+    /// Reads a little endian 16 bit integer
+    static uint16_t readUInt16(const char* buffer);
+    /// Reads a little endian 32 bit integer
+    static uint32_t readUInt32(const char* buffer);
+    /// Reads a little endian 64 bit integer
+    static int64_t readInt64(const char* buffer);
+    /// Appends a varint
+    static void writeVarint(uint64_t value, std::string& buffer);
+    /// Reads a varint at a position, returns false if it is truncated
+    static bool readVarint(const char* buffer, size_t size, size_t& pos,
+      uint64_t& value);
+    /** @}
+      */
+
+  protected:
+    /** \name Protected methods
+      @{
+      */
+    /// Appends the raw values
+    static void encodeRaw(const std::vector<int64_t>& values, size_t numRows,
+      size_t width, std::string& block);
+    /// Decodes raw values
+    static bool decodeRaw(const char* block, size_t size, size_t numRows,
+      size_t width, std::vector<int64_t>& values);
+    /// Appends the varints of the deltas
+    static void encodeVarint(const std::vector<int64_t>& values,
+      size_t numRows, std::string& block);
+    /// Decodes the varints of the deltas
+    static bool decodeVarint(const char* block, size_t size, size_t numRows,
+      std::vector<int64_t>& values);
+    /// Appends the deflated shuffled bytes, returns false if deflate failed
+    static bool encodeShuffle(const std::vector<int64_t>& values,
+      size_t numRows, size_t width, bool xorPrevious, std::string& block);
+    /// Decodes the deflated shuffled bytes
+    static bool decodeShuffle(const char* block, size_t size, size_t numRows,
+      size_t width, bool xorPrevious, std::vector<int64_t>& values);
+    /// Truncates a bit pattern to a width, sign extending 4 byte values
+    static int64_t fromWidth(uint64_t bits, size_t width);
+    /** @}
+      */
+
+  };
+
+}
+
+#endif // COLUMNAR_LOG_FORMAT_H
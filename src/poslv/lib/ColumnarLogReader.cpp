@@ -0,0 +1,212 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+#include "ColumnarLogReader.h"
+
+#include <cstring>
+
+#include <limits>
+
+#include <libposlv/exceptions/IOException.h>
+
+namespace poslv {
+
+/******************************************************************************/
+/* Constructors and Destructor                                                */
+/******************************************************************************/
+
+  ColumnarLogReader::ColumnarLogReader(const std::string& filename) :
+      _filename(filename),
+      _stream(filename.c_str(), std::ios::in | std::ios::binary) {
+    if (!_stream)
+      throw IOException("ColumnarLogReader::ColumnarLogReader(): cannot open "
+        + filename);
+    readHeader();
+    readIndex();
+  }
+
+  ColumnarLogReader::~ColumnarLogReader() {
+  }
+
+/******************************************************************************/
+/* Accessors                                                                  */
+/******************************************************************************/
+
+  const std::vector<ColumnarLogColumn>& ColumnarLogReader::getColumns() const {
+    return _columns;
+  }
+
+  size_t ColumnarLogReader::getNumChunks() const {
+    return _chunks.size();
+  }
+
+  size_t ColumnarLogReader::getNumRows() const {
+    size_t numRows = 0;
+    for (auto it = _chunks.cbegin(); it != _chunks.cend(); ++it)
+      numRows += it->mNumRows;
+    return numRows;
+  }
+
+  double ColumnarLogReader::getStartTime() const {
+    if (_chunks.empty())
+      return 0;
+    int64_t time = _chunks.front().mMinTime;
+    for (auto it = _chunks.cbegin(); it != _chunks.cend(); ++it)
+      if (it->mMinTime < time)
+        time = it->mMinTime;
+    return time * 1e-9;
+  }
+
+  double ColumnarLogReader::getEndTime() const {
+    if (_chunks.empty())
+      return 0;
+    int64_t time = _chunks.front().mMaxTime;
+    for (auto it = _chunks.cbegin(); it != _chunks.cend(); ++it)
+      if (it->mMaxTime > time)
+        time = it->mMaxTime;
+    return time * 1e-9;
+  }
+
+/******************************************************************************/
+/* Methods                                                                    */
+/******************************************************************************/
+
+  void ColumnarLogReader::readHeader() {
+    char buffer[12];
+    _stream.read(buffer, sizeof(buffer));
+    if (!_stream || std::memcmp(buffer, "PLVC", 4))
+      throw IOException("ColumnarLogReader::readHeader(): not a columnar log "
+        + _filename);
+    if (ColumnarLogFormat::readUInt32(buffer + 4) != ColumnarLogFormat::version)
+      throw IOException("ColumnarLogReader::readHeader(): unsupported version "
+        "in " + _filename);
+    const size_t numColumns = ColumnarLogFormat::readUInt32(buffer + 8);
+    for (size_t i = 0; i < numColumns; ++i) {
+      _stream.read(buffer, 2);
+      std::string name(ColumnarLogFormat::readUInt16(buffer), '\0');
+      if (!name.empty())
+        _stream.read(&name[0], name.size());
+      _stream.read(buffer, 1);
+      if (!_stream)
+        throw IOException("ColumnarLogReader::readHeader(): truncated header "
+          "in " + _filename);
+      _columns.push_back(ColumnarLogColumn(name,
+        static_cast<ColumnarLogColumn::Type>(buffer[0])));
+    }
+    if (_columns.empty())
+      throw IOException("ColumnarLogReader::readHeader(): no column in " +
+        _filename);
+  }
+
+  void ColumnarLogReader::readIndex() {
+    _stream.seekg(0, std::ios::end);
+    const std::streamoff fileSize = _stream.tellg();
+    // skip the header, its size is known from the columns
+    std::streamoff offset = 12;
+    for (auto it = _columns.cbegin(); it != _columns.cend(); ++it)
+      offset += 2 + it->mName.size() + 1;
+    const size_t headerSize = ColumnarLogFormat::chunkHeaderSize +
+      4 * _columns.size();
+    std::vector<char> header(headerSize);
+    while (offset + static_cast<std::streamoff>(headerSize) <= fileSize) {
+      _stream.seekg(offset);
+      _stream.read(&header[0], headerSize);
+      if (!_stream || std::memcmp(&header[0], "CHNK", 4))
+        break;
+      ChunkIndex chunk;
+      chunk.mNumRows = ColumnarLogFormat::readUInt32(&header[4]);
+      chunk.mMinTime = ColumnarLogFormat::readInt64(&header[8]);
+      chunk.mMaxTime = ColumnarLogFormat::readInt64(&header[16]);
+      if (!chunk.mNumRows || chunk.mNumRows > ColumnarLogFormat::maxChunkRows)
+        break;
+      offset += headerSize;
+      bool emptyBlock = false;
+      for (size_t i = 0; i < _columns.size(); ++i) {
+        const size_t blockSize = ColumnarLogFormat::readUInt32(
+          &header[ColumnarLogFormat::chunkHeaderSize + 4 * i]);
+        emptyBlock = emptyBlock || !blockSize;
+        chunk.mBlockOffsets.push_back(offset);
+        chunk.mBlockSizes.push_back(blockSize);
+        offset += blockSize;
+      }
+      if (emptyBlock || offset > fileSize)
+        break;
+      _chunks.push_back(chunk);
+    }
+    _stream.clear();
+  }
+
+  void ColumnarLogReader::readBlock(const ChunkIndex& chunk, size_t column,
+      std::vector<int64_t>& values) {
+    const size_t size = chunk.mBlockSizes[column];
+    _block.resize(size ? size : 1);
+    _stream.seekg(chunk.mBlockOffsets[column]);
+    _stream.read(&_block[0], size);
+    if (!_stream || !ColumnarLogFormat::decodeBlock(&_block[0], size,
+        chunk.mNumRows, _columns[column].mType, values))
+      throw IOException("ColumnarLogReader::readBlock(): corrupted column " +
+        _columns[column].mName + " in " + _filename);
+  }
+
+  int64_t ColumnarLogReader::toNanoseconds(double time) {
+    const double nanoseconds = time * 1e9;
+    if (nanoseconds <= std::numeric_limits<int64_t>::min())
+      return std::numeric_limits<int64_t>::min();
+    if (nanoseconds >= std::numeric_limits<int64_t>::max())
+      return std::numeric_limits<int64_t>::max();
+    return static_cast<int64_t>(nanoseconds);
+  }
+
+  void ColumnarLogReader::readColumns(const std::vector<std::string>& names,
+      double startTime, double endTime, std::vector<double>& times,
+      std::vector<std::vector<double> >& values) {
+    std::vector<size_t> columns;
+    for (auto it = names.cbegin(); it != names.cend(); ++it) {
+      size_t column = 0;
+      while (column < _columns.size() && _columns[column].mName != *it)
+        column++;
+      if (column == _columns.size())
+        throw IOException("ColumnarLogReader::readColumns(): unknown column "
+          + *it + " in " + _filename);
+      columns.push_back(column);
+    }
+    times.clear();
+    values.assign(columns.size(), std::vector<double>());
+    const int64_t start = toNanoseconds(startTime);
+    const int64_t end = toNanoseconds(endTime);
+    std::vector<int64_t> chunkTimes;
+    std::vector<int64_t> chunkValues;
+    for (auto it = _chunks.cbegin(); it != _chunks.cend(); ++it) {
+      if (it->mMaxTime < start || it->mMinTime > end)
+        continue;
+      readBlock(*it, 0, chunkTimes);
+      for (size_t i = 0; i < it->mNumRows; ++i)
+        if (chunkTimes[i] >= start && chunkTimes[i] <= end)
+          times.push_back(chunkTimes[i] * 1e-9);
+      for (size_t j = 0; j < columns.size(); ++j) {
+        readBlock(*it, columns[j], chunkValues);
+        const ColumnarLogColumn::Type type = _columns[columns[j]].mType;
+        for (size_t i = 0; i < it->mNumRows; ++i)
+          if (chunkTimes[i] >= start && chunkTimes[i] <= end)
+            values[j].push_back(ColumnarLogFormat::fromBits(chunkValues[i],
+              type));
+      }
+    }
+  }
+
+}
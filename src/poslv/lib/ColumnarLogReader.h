@@ -0,0 +1,145 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file ColumnarLogReader.h
+    \brief This file defines the ColumnarLogReader class which reads columnar
+           log files.
+  */
+
+#ifndef COLUMNAR_LOG_READER_H
+#define COLUMNAR_LOG_READER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "ColumnarLogFormat.h"
+
+namespace poslv {
+
+  /** The class ColumnarLogReader indexes the chunks of a columnar log file
+      and decodes only the requested columns of the chunks overlapping the
+      requested time range. Indexing stops at the first truncated or
+      inconsistent chunk.
+      \brief Columnar log reader
+    */
+  class ColumnarLogReader {
+  public:
+    /** \name Constructors/destructor
+      @{
+      */
+    /// Constructor
+    ColumnarLogReader(const std::string& filename);
+    /// Copy constructor
+    ColumnarLogReader(const ColumnarLogReader& other) = delete;
+    /// Copy assignment operator
+    ColumnarLogReader& operator = (const ColumnarLogReader& other) = delete;
+    /// Move constructor
+    ColumnarLogReader(ColumnarLogReader&& other) = delete;
+    /// Move assignment operator
+    ColumnarLogReader& operator = (ColumnarLogReader&& other) = delete;
+    /// Destructor
+    virtual ~ColumnarLogReader();
+    /** @}
+      */
+
+    /** \name Accessors
+      @{
+      */
+    /// Returns the columns
+    const std::vector<ColumnarLogColumn>& getColumns() const;
+    /// Returns the number of chunks
+    size_t getNumChunks() const;
+    /// Returns the number of rows
+    size_t getNumRows() const;
+    /// Returns the first time [s]
+    double getStartTime() const;
+    /// Returns the last time [s]
+    double getEndTime() const;
+    /** @}
+      */
+
+    /** \name Methods
+      @{
+      */
+    /// Reads columns within a time range [s]
+    void readColumns(const std::vector<std::string>& names,
+      double startTime, double endTime, std::vector<double>& times,
+      std::vector<std::vector<double> >& values);
+    /** @}
+      */
+
+  protected:
+    /** \name Protected types
+      @{
+      */
+    /// Location of a chunk in the file
+    struct ChunkIndex {
+      /// Number of rows
+      size_t mNumRows;
+      /// First time [ns]
+      int64_t mMinTime;
+      /// Last time [ns]
+      int64_t mMaxTime;
+      /// Offsets of the column blocks
+      std::vector<std::streamoff> mBlockOffsets;
+      /// Sizes of the column blocks
+      std::vector<size_t> mBlockSizes;
+    };
+    /** @}
+      */
+
+    /** \name Protected methods
+      @{
+      */
+    /// Reads the file header
+    void readHeader();
+    /// Reads the chunk headers
+    void readIndex();
+    /// Converts a time [s] to nanoseconds, saturating out of range values
+    static int64_t toNanoseconds(double time);
+    /// Decodes a column block of a chunk
+    void readBlock(const ChunkIndex& chunk, size_t column,
+      std::vector<int64_t>& values);
+    /** @}
+      */
+
+    /** \name Protected members
+      @{
+      */
+    /// File name
+    std::string _filename;
+    /// File stream
+    std::ifstream _stream;
+    /// Columns
+    std::vector<ColumnarLogColumn> _columns;
+    /// Chunk index
+    std::vector<ChunkIndex> _chunks;
+    /// Block buffer
+    std::vector<char> _block;
+    /** @}
+      */
+
+  };
+
+}
+
+#endif // COLUMNAR_LOG_READER_H
@@ -0,0 +1,300 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+#include "ColumnarLogWriter.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include <libposlv/exceptions/IOException.h>
+#include <libposlv/exceptions/SystemException.h>
+
+namespace poslv {
+
+/******************************************************************************/
+/* Constructors and Destructor                                                */
+/******************************************************************************/
+
+  ColumnarLogWriter::ColumnarLogWriter(const std::string& directory,
+      size_t chunkSize, size_t maxQueuedChunks, double flushPeriod) :
+      _directory(directory),
+      _chunkSize(chunkSize ? (chunkSize < ColumnarLogFormat::maxChunkRows ?
+        chunkSize : ColumnarLogFormat::maxChunkRows) : 1),
+      _maxQueuedChunks(maxQueuedChunks ? maxQueuedChunks : 1),
+      _flushPeriod(flushPeriod),
+      _column(0),
+      _stop(false),
+      _numRows(0),
+      _numBytes(0),
+      _numRawBytes(0),
+      _numDroppedChunks(0),
+      _numWriteErrors(0) {
+    for (size_t pos = _directory.find('/', 1); ;
+        pos = _directory.find('/', pos + 1)) {
+      const std::string path = _directory.substr(0, pos);
+      if (!path.empty() && mkdir(path.c_str(), 0755) && errno != EEXIST)
+        throw SystemException(errno,
+          "ColumnarLogWriter::ColumnarLogWriter()::mkdir()");
+      if (pos == std::string::npos)
+        break;
+    }
+    _thread = std::thread(&ColumnarLogWriter::run, this);
+  }
+
+  ColumnarLogWriter::~ColumnarLogWriter() {
+    flush();
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _condition.notify_one();
+    _thread.join();
+  }
+
+/******************************************************************************/
+/* Accessors                                                                  */
+/******************************************************************************/
+
+  const std::string& ColumnarLogWriter::getDirectory() const {
+    return _directory;
+  }
+
+  size_t ColumnarLogWriter::getNumRows() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numRows;
+  }
+
+  size_t ColumnarLogWriter::getNumBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numBytes;
+  }
+
+  size_t ColumnarLogWriter::getNumRawBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numRawBytes;
+  }
+
+  size_t ColumnarLogWriter::getNumDroppedChunks() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numDroppedChunks;
+  }
+
+  size_t ColumnarLogWriter::getNumWriteErrors() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numWriteErrors;
+  }
+
+/******************************************************************************/
+/* Methods                                                                    */
+/******************************************************************************/
+
+  size_t ColumnarLogWriter::addTable(const std::string& name,
+      const std::vector<ColumnarLogColumn>& columns) {
+    auto table = std::make_shared<Table>();
+    table->mName = name;
+    table->mFilename = _directory + "/" + name + ".col";
+    table->mColumns = columns;
+    table->mRowSize = 0;
+    for (auto it = columns.cbegin(); it != columns.cend(); ++it)
+      table->mRowSize += it->mRawSize;
+    table->mFailed = false;
+    const std::string& filename = table->mFilename;
+    const int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+      throw SystemException(errno, "ColumnarLogWriter::addTable()::open(): "
+        + filename);
+    ::close(fd);
+    table->mStream.open(filename.c_str(),
+      std::ios::in | std::ios::out | std::ios::binary);
+    std::string header;
+    ColumnarLogFormat::encodeHeader(columns, header);
+    table->mStream.write(header.data(), header.size());
+    table->mStream.flush();
+    if (!table->mStream)
+      throw IOException("ColumnarLogWriter::addTable(): cannot write " +
+        filename);
+    table->mChunk = getChunk(table);
+    _tables.push_back(table);
+    return _tables.size() - 1;
+  }
+
+  void ColumnarLogWriter::beginRow(size_t table) {
+    _table = _tables.at(table);
+    _column = 0;
+  }
+
+  void ColumnarLogWriter::addInteger(int64_t value) {
+    if (!_table || _column >= _table->mColumns.size())
+      return;
+    Chunk& chunk = *_table->mChunk;
+    chunk.mColumns[_column++][chunk.mNumRows] = value;
+  }
+
+  void ColumnarLogWriter::addReal(double value) {
+    if (!_table || _column >= _table->mColumns.size())
+      return;
+    Chunk& chunk = *_table->mChunk;
+    chunk.mColumns[_column][chunk.mNumRows] =
+      ColumnarLogFormat::toBits(value, _table->mColumns[_column].mType);
+    _column++;
+  }
+
+  void ColumnarLogWriter::endRow() {
+    if (!_table)
+      return;
+    const size_t numRows = ++_table->mChunk->mNumRows;
+    const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+    if (numRows == 1)
+      _table->mChunkStart = now;
+    if (numRows == _chunkSize || isExpired(*_table, now))
+      queueChunk(_table);
+    _table.reset();
+  }
+
+  void ColumnarLogWriter::flush() {
+    for (auto it = _tables.cbegin(); it != _tables.cend(); ++it)
+      queueChunk(*it);
+  }
+
+  void ColumnarLogWriter::flushExpired() {
+    const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+    for (auto it = _tables.cbegin(); it != _tables.cend(); ++it)
+      if (isExpired(**it, now))
+        queueChunk(*it);
+  }
+
+  bool ColumnarLogWriter::isExpired(const Table& table,
+      const std::chrono::steady_clock::time_point& now) const {
+    return _flushPeriod > 0 && table.mChunk->mNumRows &&
+      std::chrono::duration<double>(now - table.mChunkStart).count() >=
+      _flushPeriod;
+  }
+
+  std::shared_ptr<ColumnarLogWriter::Chunk> ColumnarLogWriter::getChunk(
+      const std::shared_ptr<Table>& table) {
+    std::shared_ptr<Chunk> chunk;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_freeChunks.empty()) {
+        chunk = _freeChunks.back();
+        _freeChunks.pop_back();
+      }
+    }
+    if (!chunk)
+      chunk = std::make_shared<Chunk>();
+    chunk->mTable = table;
+    chunk->mColumns.resize(table->mColumns.size());
+    for (auto it = chunk->mColumns.begin(); it != chunk->mColumns.end(); ++it)
+      it->resize(_chunkSize);
+    chunk->mNumRows = 0;
+    return chunk;
+  }
+
+  void ColumnarLogWriter::queueChunk(const std::shared_ptr<Table>& table) {
+    if (!table->mChunk->mNumRows)
+      return;
+    std::shared_ptr<Chunk> chunk = table->mChunk;
+    table->mChunk = getChunk(table);
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_queue.size() >= _maxQueuedChunks) {
+        _numDroppedChunks++;
+        chunk->mTable.reset();
+        _freeChunks.push_back(chunk);
+        return;
+      }
+      _queue.push_back(chunk);
+    }
+    _condition.notify_one();
+  }
+
+  void ColumnarLogWriter::writeChunk(const Chunk& chunk) {
+    const std::vector<int64_t>& times = chunk.mColumns[0];
+    int64_t minTime = times[0];
+    int64_t maxTime = times[0];
+    for (size_t i = 1; i < chunk.mNumRows; ++i) {
+      if (times[i] < minTime)
+        minTime = times[i];
+      if (times[i] > maxTime)
+        maxTime = times[i];
+    }
+    std::string header("CHNK");
+    ColumnarLogFormat::writeUInt32(chunk.mNumRows, header);
+    ColumnarLogFormat::writeInt64(minTime, header);
+    ColumnarLogFormat::writeInt64(maxTime, header);
+    std::string blocks;
+    std::string block;
+    const std::vector<ColumnarLogColumn>& columns = chunk.mTable->mColumns;
+    for (size_t i = 0; i < chunk.mColumns.size(); ++i) {
+      ColumnarLogFormat::encodeBlock(chunk.mColumns[i], chunk.mNumRows,
+        columns[i].mType, block);
+      ColumnarLogFormat::writeUInt32(block.size(), header);
+      blocks.append(block);
+    }
+    Table& table = *chunk.mTable;
+    if (table.mFailed) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _numDroppedChunks++;
+      return;
+    }
+    std::fstream& stream = table.mStream;
+    const std::streamoff position = stream.tellp();
+    stream.write(header.data(), header.size());
+    stream.write(blocks.data(), blocks.size());
+    stream.flush();
+    if (!stream) {
+      // cut the partial chunk, the reader stops at the first broken one
+      stream.clear();
+      stream.seekp(position);
+      if (position < 0 || !stream ||
+          ::truncate(table.mFilename.c_str(), position))
+        table.mFailed = true;
+      std::lock_guard<std::mutex> lock(_mutex);
+      _numWriteErrors++;
+      return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _numRows += chunk.mNumRows;
+    _numBytes += header.size() + blocks.size();
+    _numRawBytes += chunk.mNumRows * table.mRowSize;
+  }
+
+  void ColumnarLogWriter::run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+      while (_queue.empty() && !_stop)
+        _condition.wait(lock);
+      if (_queue.empty())
+        break;
+      std::shared_ptr<Chunk> chunk = _queue.front();
+      _queue.pop_front();
+      lock.unlock();
+      writeChunk(*chunk);
+      lock.lock();
+      chunk->mTable.reset();
+      _freeChunks.push_back(chunk);
+    }
+  }
+
+}
@@ -0,0 +1,216 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file ColumnarLogWriter.h
+    \brief This file defines the ColumnarLogWriter class which writes
+           compressed columnar log files on a background thread.
+  */
+
+#ifndef COLUMNAR_LOG_WRITER_H
+#define COLUMNAR_LOG_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ColumnarLogFormat.h"
+
+namespace poslv {
+
+  /** The class ColumnarLogWriter writes one columnar log file per table.
+      Rows are accumulated into chunks on the calling thread, full chunks are
+      handed to a background thread that encodes and writes them. Partial
+      chunks older than the flush period are handed over as well, which
+      bounds the rows lost on a crash for slow tables. The number of queued
+      chunks is bounded, chunks are dropped when the disk cannot keep up
+      rather than blocking the caller.
+      \brief Columnar log writer
+    */
+  class ColumnarLogWriter {
+  public:
+    /** \name Constructors/destructor
+      @{
+      */
+    /// Constructor
+    ColumnarLogWriter(const std::string& directory, size_t chunkSize = 4096,
+      size_t maxQueuedChunks = 16, double flushPeriod = 10);
+    /// Copy constructor
+    ColumnarLogWriter(const ColumnarLogWriter& other) = delete;
+    /// Copy assignment operator
+    ColumnarLogWriter& operator = (const ColumnarLogWriter& other) = delete;
+    /// Move constructor
+    ColumnarLogWriter(ColumnarLogWriter&& other) = delete;
+    /// Move assignment operator
+    ColumnarLogWriter& operator = (ColumnarLogWriter&& other) = delete;
+    /// Destructor
+    virtual ~ColumnarLogWriter();
+    /** @}
+      */
+
+    /** \name Accessors
+      @{
+      */
+    /// Returns the log directory
+    const std::string& getDirectory() const;
+    /// Returns the number of rows written
+    size_t getNumRows() const;
+    /// Returns the number of bytes written
+    size_t getNumBytes() const;
+    /// Returns the number of bytes of the source fields written
+    size_t getNumRawBytes() const;
+    /// Returns the number of chunks dropped
+    size_t getNumDroppedChunks() const;
+    /// Returns the number of write errors
+    size_t getNumWriteErrors() const;
+    /** @}
+      */
+
+    /** \name Methods
+      @{
+      */
+    /// Adds a table and returns its index, the first column is the time [ns]
+    /// and the file must not exist
+    size_t addTable(const std::string& name,
+      const std::vector<ColumnarLogColumn>& columns);
+    /// Starts a row of a table
+    void beginRow(size_t table);
+    /// Sets the next column of the row from an integer
+    void addInteger(int64_t value);
+    /// Sets the next column of the row from a real
+    void addReal(double value);
+    /// Ends the row
+    void endRow();
+    /// Hands all the partial chunks to the background thread
+    void flush();
+    /// Hands the partial chunks older than the flush period to the
+    /// background thread
+    void flushExpired();
+    /** @}
+      */
+
+  protected:
+    /** \name Protected types
+      @{
+      */
+    struct Chunk;
+    /// Table with its file and the chunk being filled
+    struct Table {
+      /// Table name
+      std::string mName;
+      /// File name
+      std::string mFilename;
+      /// Columns
+      std::vector<ColumnarLogColumn> mColumns;
+      /// Uncompressed size of a row
+      size_t mRowSize;
+      /// File stream, only used by the background thread once opened
+      std::fstream mStream;
+      /// Whether a failed write could not be undone, only used by the
+      /// background thread
+      bool mFailed;
+      /// Chunk being filled
+      std::shared_ptr<Chunk> mChunk;
+      /// Time at which the first row of the chunk was added
+      std::chrono::steady_clock::time_point mChunkStart;
+    };
+    /// Chunk of rows stored column by column
+    struct Chunk {
+      /// Table of the chunk
+      std::shared_ptr<Table> mTable;
+      /// Columns
+      std::vector<std::vector<int64_t> > mColumns;
+      /// Number of rows
+      size_t mNumRows;
+    };
+    /** @}
+      */
+
+    /** \name Protected methods
+      @{
+      */
+    /// Returns an empty chunk for a table
+    std::shared_ptr<Chunk> getChunk(const std::shared_ptr<Table>& table);
+    /// Queues the chunk of a table
+    void queueChunk(const std::shared_ptr<Table>& table);
+    /// Returns whether the partial chunk of a table is older than the flush
+    /// period
+    bool isExpired(const Table& table,
+      const std::chrono::steady_clock::time_point& now) const;
+    /// Encodes and writes a chunk
+    void writeChunk(const Chunk& chunk);
+    /// Background thread
+    void run();
+    /** @}
+      */
+
+    /** \name Protected members
+      @{
+      */
+    /// Log directory
+    std::string _directory;
+    /// Number of rows per chunk
+    size_t _chunkSize;
+    /// Maximum number of queued chunks
+    size_t _maxQueuedChunks;
+    /// Maximum age of a partial chunk [s], not enforced if not positive
+    double _flushPeriod;
+    /// Tables
+    std::vector<std::shared_ptr<Table> > _tables;
+    /// Table of the current row
+    std::shared_ptr<Table> _table;
+    /// Next column of the current row
+    size_t _column;
+    /// Chunks waiting to be written
+    std::deque<std::shared_ptr<Chunk> > _queue;
+    /// Chunks ready for reuse
+    std::vector<std::shared_ptr<Chunk> > _freeChunks;
+    /// Mutex protecting the queue, the free chunks and the counters
+    mutable std::mutex _mutex;
+    /// Condition signaling queued chunks
+    std::condition_variable _condition;
+    /// Whether the background thread should stop
+    bool _stop;
+    /// Number of rows written
+    size_t _numRows;
+    /// Number of bytes written
+    size_t _numBytes;
+    /// Number of bytes of the source fields written
+    size_t _numRawBytes;
+    /// Number of chunks dropped
+    size_t _numDroppedChunks;
+    /// Number of write errors
+    size_t _numWriteErrors;
+    /// Background thread
+    std::thread _thread;
+    /** @}
+      */
+
+  };
+
+}
+
+#endif // COLUMNAR_LOG_WRITER_H
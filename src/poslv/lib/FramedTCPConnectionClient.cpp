@@ -0,0 +1,212 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+#include "FramedTCPConnectionClient.h"
+
+#include <sys/select.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+
+#include <libposlv/exceptions/IOException.h>
+#include <libposlv/exceptions/SystemException.h>
+
+namespace poslv {
+
+  const size_t FramedTCPConnectionClient::maxFrameSize;
+
+/******************************************************************************/
+/* Constructors and Destructor                                                */
+/******************************************************************************/
+
+  FramedTCPConnectionClient::FramedTCPConnectionClient(const std::string&
+      serverIP, short port, double timeout, size_t bufferSize) :
+      TCPConnectionClient(serverIP, port),
+      _buffer(bufferSize > maxFrameSize ? bufferSize : maxFrameSize),
+      _begin(0),
+      _end(0),
+      _frameBegin(0),
+      _frameEnd(0),
+      _timeout(timeout),
+      _numReads(0),
+      _numBytes(0),
+      _numFrames(0),
+      _numDiscardedBytes(0),
+      _numRejectedFrames(0) {
+  }
+
+  FramedTCPConnectionClient::~FramedTCPConnectionClient() {
+  }
+
+/******************************************************************************/
+/* Accessors                                                                  */
+/******************************************************************************/
+
+  size_t FramedTCPConnectionClient::getNumReads() const {
+    return _numReads;
+  }
+
+  size_t FramedTCPConnectionClient::getNumBytes() const {
+    return _numBytes;
+  }
+
+  size_t FramedTCPConnectionClient::getNumFrames() const {
+    return _numFrames;
+  }
+
+  size_t FramedTCPConnectionClient::getNumDiscardedBytes() const {
+    return _numDiscardedBytes;
+  }
+
+  size_t FramedTCPConnectionClient::getNumRejectedFrames() const {
+    return _numRejectedFrames;
+  }
+
+  void FramedTCPConnectionClient::setTimeout(double timeout) {
+    _timeout = timeout;
+  }
+
+  void FramedTCPConnectionClient::setBufferSize(size_t bufferSize) {
+    compact();
+    size_t size = bufferSize > maxFrameSize ? bufferSize : maxFrameSize;
+    if (size < _end)
+      size = _end;
+    _buffer.resize(size);
+  }
+
+/******************************************************************************/
+/* Methods                                                                    */
+/******************************************************************************/
+
+  void FramedTCPConnectionClient::synchronize() {
+    while (_end - _begin >= 4) {
+      if (!std::memcmp(&_buffer[_begin], "$GRP", 4) ||
+          !std::memcmp(&_buffer[_begin], "$MSG", 4))
+        return;
+      _begin++;
+      _numDiscardedBytes++;
+    }
+  }
+
+  void FramedTCPConnectionClient::compact() {
+    if (!_begin)
+      return;
+    std::memmove(&_buffer[0], &_buffer[_begin], _end - _begin);
+    _end -= _begin;
+    _frameBegin = _frameBegin > _begin ? _frameBegin - _begin : 0;
+    _frameEnd = _frameEnd > _begin ? _frameEnd - _begin : 0;
+    _begin = 0;
+  }
+
+  size_t FramedTCPConnectionClient::getFrameSize() const {
+    // start (4), ID (2) and byte count (2), little endian
+    if (_end - _begin < 8)
+      return 0;
+    const size_t byteCount =
+      static_cast<uint8_t>(_buffer[_begin + 6]) |
+      (static_cast<uint8_t>(_buffer[_begin + 7]) << 8);
+    const size_t frameSize = 8 + byteCount;
+    return (_end - _begin >= frameSize) ? frameSize : 0;
+  }
+
+  void FramedTCPConnectionClient::fill() {
+    discardFrame();
+    synchronize();
+    if (getFrameSize())
+      return;
+    if (!isOpen())
+      open();
+    compact();
+    fd_set readFlags;
+    FD_ZERO(&readFlags);
+    FD_SET(mSocket, &readFlags);
+    struct timeval waitd;
+    waitd.tv_sec = static_cast<long>(_timeout);
+    waitd.tv_usec = static_cast<long>((_timeout - waitd.tv_sec) * 1e6);
+    const int res = select(mSocket + 1, &readFlags, 0, 0, &waitd);
+    if (res < 0)
+      throw SystemException(errno,
+        "FramedTCPConnectionClient::fill()::select()");
+    if (res == 0)
+      throw IOException("FramedTCPConnectionClient::fill(): timeout occured");
+    const ssize_t numBytes = ::read(mSocket, &_buffer[_end],
+      _buffer.size() - _end);
+    _numReads++;
+    if (numBytes < 0) {
+      const int errNo = errno;
+      close();
+      clear();
+      throw SystemException(errNo,
+        "FramedTCPConnectionClient::fill()::read()");
+    }
+    if (numBytes == 0) {
+      close();
+      clear();
+      throw IOException("FramedTCPConnectionClient::fill(): "
+        "connection closed by peer");
+    }
+    _end += numBytes;
+    _numBytes += numBytes;
+    synchronize();
+  }
+
+  bool FramedTCPConnectionClient::nextFrame() {
+    discardFrame();
+    synchronize();
+    const size_t frameSize = getFrameSize();
+    if (!frameSize)
+      return false;
+    _frameBegin = _begin;
+    _frameEnd = _begin + frameSize;
+    _numFrames++;
+    return true;
+  }
+
+  void FramedTCPConnectionClient::discardFrame() {
+    if (_frameEnd > _begin)
+      _begin = _frameEnd;
+  }
+
+  void FramedTCPConnectionClient::rejectFrame() {
+    if (_frameEnd <= _frameBegin)
+      return;
+    // a false start can announce a length spanning valid packets
+    _begin = _frameBegin + 1;
+    _frameEnd = _begin;
+    _numDiscardedBytes++;
+    _numRejectedFrames++;
+  }
+
+  void FramedTCPConnectionClient::read(char* buffer, size_t numBytes) {
+    if (_begin + numBytes > _frameEnd)
+      throw IOException("FramedTCPConnectionClient::read(): "
+        "read past packet boundary");
+    std::memcpy(buffer, &_buffer[_begin], numBytes);
+    _begin += numBytes;
+  }
+
+  void FramedTCPConnectionClient::clear() {
+    _begin = 0;
+    _end = 0;
+    _frameBegin = 0;
+    _frameEnd = 0;
+  }
+
+}
@@ -0,0 +1,157 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file FramedTCPConnectionClient.h
+    \brief This file defines the FramedTCPConnectionClient class which
+           buffers the POS LV TCP stream and splits it into packets.
+  */
+
+#ifndef FRAMED_TCP_CONNECTION_CLIENT_H
+#define FRAMED_TCP_CONNECTION_CLIENT_H
+
+#include <cstddef>
+
+#include <string>
+#include <vector>
+
+#include <libposlv/com/TCPConnectionClient.h>
+
+namespace poslv {
+
+  /** The class FramedTCPConnectionClient drains all the bytes available on the
+      socket into a reusable buffer with a single read and serves them packet
+      by packet to POSLVComTCP.
+      \brief Framed TCP connection client
+    */
+  class FramedTCPConnectionClient :
+    public TCPConnectionClient {
+  public:
+    /** \name Constants
+      @{
+      */
+    /// Size of the largest packet, header (8) and maximum byte count
+    static const size_t maxFrameSize = 8 + 65535;
+    /** @}
+      */
+
+    /** \name Constructors/destructor
+      @{
+      */
+    /// Constructor
+    FramedTCPConnectionClient(const std::string& serverIP, short port,
+      double timeout = 2.5, size_t bufferSize = 131072);
+    /// Copy constructor
+    FramedTCPConnectionClient(const FramedTCPConnectionClient& other) = delete;
+    /// Copy assignment operator
+    FramedTCPConnectionClient& operator =
+      (const FramedTCPConnectionClient& other) = delete;
+    /// Move constructor
+    FramedTCPConnectionClient(FramedTCPConnectionClient&& other) = delete;
+    /// Move assignment operator
+    FramedTCPConnectionClient& operator =
+      (FramedTCPConnectionClient&& other) = delete;
+    /// Destructor
+    virtual ~FramedTCPConnectionClient();
+    /** @}
+      */
+
+    /** \name Methods
+      @{
+      */
+    /// Reads all available bytes unless a complete packet is buffered
+    void fill();
+    /// Starts the next complete packet, returns false if there is none
+    bool nextFrame();
+    /// Drops what remains of the current packet
+    void discardFrame();
+    /// Drops the first byte of the current malformed packet and
+    /// resynchronizes on the following bytes, which may hold valid packets
+    void rejectFrame();
+    /// Reads bytes from the current packet
+    virtual void read(char* buffer, size_t numBytes);
+    /// Drops buffered bytes, e.g., after the connection was lost
+    void clear();
+    /** @}
+      */
+
+    /** \name Accessors
+      @{
+      */
+    /// Returns the number of read system calls
+    size_t getNumReads() const;
+    /// Returns the number of bytes received
+    size_t getNumBytes() const;
+    /// Returns the number of packets framed
+    size_t getNumFrames() const;
+    /// Returns the number of bytes discarded while resynchronizing
+    size_t getNumDiscardedBytes() const;
+    /// Returns the number of malformed packets rejected
+    size_t getNumRejectedFrames() const;
+    /// Sets the timeout when waiting for data
+    void setTimeout(double timeout);
+    /// Sets the receive buffer size, never below a packet or the held bytes
+    void setBufferSize(size_t bufferSize);
+    /** @}
+      */
+
+  protected:
+    /** \name Protected methods
+      @{
+      */
+    /// Skips bytes until a packet start is found at the buffer head
+    void synchronize();
+    /// Moves the unread bytes to the front of the buffer
+    void compact();
+    /// Returns the size of the packet at the buffer head, 0 if incomplete
+    size_t getFrameSize() const;
+    /** @}
+      */
+
+    /** \name Protected members
+      @{
+      */
+    /// Receive buffer, never smaller than a packet
+    std::vector<char> _buffer;
+    /// Position of the first unread byte
+    size_t _begin;
+    /// Position past the last received byte
+    size_t _end;
+    /// Position of the first byte of the current packet
+    size_t _frameBegin;
+    /// Position past the last byte of the current packet
+    size_t _frameEnd;
+    /// Timeout when waiting for data
+    double _timeout;
+    /// Number of read system calls
+    size_t _numReads;
+    /// Number of bytes received
+    size_t _numBytes;
+    /// Number of packets framed
+    size_t _numFrames;
+    /// Number of bytes discarded while resynchronizing
+    size_t _numDiscardedBytes;
+    /// Number of malformed packets rejected
+    size_t _numRejectedFrames;
+    /** @}
+      */
+
+  };
+
+}
+
+#endif // FRAMED_TCP_CONNECTION_CLIENT_H
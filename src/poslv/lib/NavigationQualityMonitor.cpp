@@ -0,0 +1,241 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+#include "NavigationQualityMonitor.h"
+
+#include <cmath>
+
+#include <libposlv/types/VehicleNavigationSolution.h>
+#include <libposlv/types/VehicleNavigationPerformance.h>
+
+namespace {
+
+  /// WGS84 semi-major axis [m]
+  const double wgs84A = 6378137.0;
+  /// WGS84 squared eccentricity
+  const double wgs84E2 = 6.69437999014e-3;
+  /// Degrees to radians
+  const double deg2Rad = M_PI / 180.0;
+
+}
+
+namespace poslv {
+
+/******************************************************************************/
+/* Constructors and Destructor                                                */
+/******************************************************************************/
+
+  NavigationQualityMonitor::NavigationQualityMonitor(size_t windowSize,
+      size_t performanceWindowSize, double maxTimeGap) :
+      _maxTimeGap(maxTimeGap),
+      _headingRateResidual(windowSize),
+      _horizontalVelocityResidual(windowSize),
+      _downVelocityResidual(windowSize),
+      _accelerationResidual(windowSize),
+      _positionRMSError(performanceWindowSize),
+      _headingRMSError(performanceWindowSize),
+      _positionRMSErrorRatio(1),
+      _headingRMSErrorRatio(1),
+      _hasLastSolution(false),
+      _lastTime(0),
+      _lastLatitude(0),
+      _lastLongitude(0),
+      _lastAltitude(0),
+      _lastNorthVelocity(0),
+      _lastEastVelocity(0),
+      _lastDownVelocity(0),
+      _lastHeading(0),
+      _lastHeadingRate(0),
+      _lastLongitudinalSpeed(0),
+      _lastAccLong(0) {
+  }
+
+  NavigationQualityMonitor::~NavigationQualityMonitor() {
+  }
+
+/******************************************************************************/
+/* Accessors                                                                  */
+/******************************************************************************/
+
+  void NavigationQualityMonitor::setWindowSize(size_t windowSize) {
+    _headingRateResidual.setWindowSize(windowSize);
+    _horizontalVelocityResidual.setWindowSize(windowSize);
+    _downVelocityResidual.setWindowSize(windowSize);
+    _accelerationResidual.setWindowSize(windowSize);
+  }
+
+  void NavigationQualityMonitor::setPerformanceWindowSize(size_t windowSize) {
+    _positionRMSError.setWindowSize(windowSize);
+    _headingRMSError.setWindowSize(windowSize);
+    _positionRMSErrorRatio = 1;
+    _headingRMSErrorRatio = 1;
+  }
+
+  void NavigationQualityMonitor::setMaxTimeGap(double maxTimeGap) {
+    _maxTimeGap = maxTimeGap;
+  }
+
+  const RollingStatistics& NavigationQualityMonitor::getHeadingRateResidual()
+      const {
+    return _headingRateResidual;
+  }
+
+  const RollingStatistics&
+      NavigationQualityMonitor::getHorizontalVelocityResidual() const {
+    return _horizontalVelocityResidual;
+  }
+
+  const RollingStatistics& NavigationQualityMonitor::getDownVelocityResidual()
+      const {
+    return _downVelocityResidual;
+  }
+
+  const RollingStatistics& NavigationQualityMonitor::getAccelerationResidual()
+      const {
+    return _accelerationResidual;
+  }
+
+  const RollingStatistics& NavigationQualityMonitor::getPositionRMSError()
+      const {
+    return _positionRMSError;
+  }
+
+  const RollingStatistics& NavigationQualityMonitor::getHeadingRMSError()
+      const {
+    return _headingRMSError;
+  }
+
+  double NavigationQualityMonitor::getPositionRMSErrorRatio() const {
+    return _positionRMSErrorRatio;
+  }
+
+  double NavigationQualityMonitor::getHeadingRMSErrorRatio() const {
+    return _headingRMSErrorRatio;
+  }
+
+  size_t NavigationQualityMonitor::getNumRejectedSamples() const {
+    return _headingRateResidual.getNumRejectedSamples() +
+      _horizontalVelocityResidual.getNumRejectedSamples() +
+      _downVelocityResidual.getNumRejectedSamples() +
+      _accelerationResidual.getNumRejectedSamples() +
+      _positionRMSError.getNumRejectedSamples() +
+      _headingRMSError.getNumRejectedSamples();
+  }
+
+  bool NavigationQualityMonitor::hasRejectedSamples() const {
+    return _headingRateResidual.hasRejectedSamples() ||
+      _horizontalVelocityResidual.hasRejectedSamples() ||
+      _downVelocityResidual.hasRejectedSamples() ||
+      _accelerationResidual.hasRejectedSamples() ||
+      _positionRMSError.hasRejectedSamples() ||
+      _headingRMSError.hasRejectedSamples();
+  }
+
+/******************************************************************************/
+/* Methods                                                                    */
+/******************************************************************************/
+
+  void NavigationQualityMonitor::addSolution(
+      const VehicleNavigationSolution& vns) {
+    const double time = vns.mTimeDistance.mTime2;
+    const double roll = vns.mRoll * deg2Rad;
+    const double pitch = vns.mPitch * deg2Rad;
+    const double cosPitch = std::cos(pitch);
+    // Euler heading rate from the transverse and down body rates
+    const double headingRate = std::fabs(cosPitch) > 1e-3 ?
+      (vns.mAngularRateTrans * std::sin(roll) +
+      vns.mAngularRateDown * std::cos(roll)) / cosPitch : 0;
+    // the speed is unsigned, the longitudinal acceleration is not
+    const double heading = vns.mHeading * deg2Rad;
+    const double longitudinalSpeed = vns.mNorthVelocity * std::cos(heading) +
+      vns.mEastVelocity * std::sin(heading);
+    const double dt = time - _lastTime;
+    if (_hasLastSolution && dt > 0 && dt <= _maxTimeGap) {
+      double headingDelta = vns.mHeading - _lastHeading;
+      headingDelta -= 360.0 * std::floor((headingDelta + 180.0) / 360.0);
+      _headingRateResidual.addSample(headingDelta / dt -
+        0.5 * (headingRate + _lastHeadingRate));
+      const double latitude = 0.5 * (vns.mLatitude + _lastLatitude) * deg2Rad;
+      const double sinLatitude = std::sin(latitude);
+      const double w = 1.0 - wgs84E2 * sinLatitude * sinLatitude;
+      const double altitude = 0.5 * (vns.mAltitude + _lastAltitude);
+      const double meridianRadius = wgs84A * (1.0 - wgs84E2) /
+        (w * std::sqrt(w)) + altitude;
+      const double normalRadius = wgs84A / std::sqrt(w) + altitude;
+      double longitudeDelta = vns.mLongitude - _lastLongitude;
+      longitudeDelta -= 360.0 * std::floor((longitudeDelta + 180.0) / 360.0);
+      const double northResidual = (vns.mLatitude - _lastLatitude) * deg2Rad *
+        meridianRadius / dt - 0.5 * (vns.mNorthVelocity + _lastNorthVelocity);
+      const double eastResidual = longitudeDelta * deg2Rad * normalRadius *
+        std::cos(latitude) / dt -
+        0.5 * (vns.mEastVelocity + _lastEastVelocity);
+      _horizontalVelocityResidual.addSample(std::sqrt(northResidual *
+        northResidual + eastResidual * eastResidual));
+      _downVelocityResidual.addSample((_lastAltitude - vns.mAltitude) / dt -
+        0.5 * (vns.mDownVelocity + _lastDownVelocity));
+      _accelerationResidual.addSample((longitudinalSpeed -
+        _lastLongitudinalSpeed) / dt - 0.5 * (vns.mAccLong + _lastAccLong));
+    }
+    _hasLastSolution = true;
+    _lastTime = time;
+    _lastLatitude = vns.mLatitude;
+    _lastLongitude = vns.mLongitude;
+    _lastAltitude = vns.mAltitude;
+    _lastNorthVelocity = vns.mNorthVelocity;
+    _lastEastVelocity = vns.mEastVelocity;
+    _lastDownVelocity = vns.mDownVelocity;
+    _lastHeading = vns.mHeading;
+    _lastHeadingRate = headingRate;
+    _lastLongitudinalSpeed = longitudinalSpeed;
+    _lastAccLong = vns.mAccLong;
+  }
+
+  void NavigationQualityMonitor::addPerformance(
+      const VehicleNavigationPerformance& vnp) {
+    const double positionRMSError = std::sqrt(
+      vnp.mNorthPositionRMSError * vnp.mNorthPositionRMSError +
+      vnp.mEastPositionRMSError * vnp.mEastPositionRMSError +
+      vnp.mDownPositionRMSError * vnp.mDownPositionRMSError);
+    _positionRMSErrorRatio = addRatioSample(_positionRMSError,
+      positionRMSError);
+    _headingRMSErrorRatio = addRatioSample(_headingRMSError,
+      vnp.mHeadingRMSError);
+  }
+
+  double NavigationQualityMonitor::addRatioSample(RollingStatistics&
+      statistics, double value) {
+    const double mean = statistics.getMean();
+    const double ratio = (statistics.getNumSamples() && mean > 0) ?
+      value / mean : 1;
+    statistics.addSample(value);
+    return ratio;
+  }
+
+  void NavigationQualityMonitor::clear() {
+    _headingRateResidual.clear();
+    _horizontalVelocityResidual.clear();
+    _downVelocityResidual.clear();
+    _accelerationResidual.clear();
+    _positionRMSError.clear();
+    _headingRMSError.clear();
+    _positionRMSErrorRatio = 1;
+    _headingRMSErrorRatio = 1;
+    _hasLastSolution = false;
+  }
+
+}
@@ -0,0 +1,171 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file NavigationQualityMonitor.h
+    \brief This file defines the NavigationQualityMonitor class which checks
+           the consistency of the navigation stream.
+  */
+
+#ifndef NAVIGATION_QUALITY_MONITOR_H
+#define NAVIGATION_QUALITY_MONITOR_H
+
+#include <cstddef>
+
+#include "RollingStatistics.h"
+
+class VehicleNavigationSolution;
+class VehicleNavigationPerformance;
+
+namespace poslv {
+
+  /** The class NavigationQualityMonitor computes residuals between the
+      heading and the angular rates, the position and the integrated velocity,
+      the signed longitudinal speed and the longitudinal acceleration, and
+      tracks jumps of the reported RMS errors. Each sample is processed in
+      constant time.
+      \brief Navigation quality monitor
+    */
+  class NavigationQualityMonitor {
+  public:
+    /** \name Constructors/destructor
+      @{
+      */
+    /// Constructor
+    NavigationQualityMonitor(size_t windowSize = 100,
+      size_t performanceWindowSize = 30, double maxTimeGap = 1.0);
+    /// Copy constructor
+    NavigationQualityMonitor(const NavigationQualityMonitor& other) = delete;
+    /// Copy assignment operator
+    NavigationQualityMonitor& operator =
+      (const NavigationQualityMonitor& other) = delete;
+    /// Move constructor
+    NavigationQualityMonitor(NavigationQualityMonitor&& other) = delete;
+    /// Move assignment operator
+    NavigationQualityMonitor& operator =
+      (NavigationQualityMonitor&& other) = delete;
+    /// Destructor
+    virtual ~NavigationQualityMonitor();
+    /** @}
+      */
+
+    /** \name Accessors
+      @{
+      */
+    /// Sets the window size for the navigation solution residuals
+    void setWindowSize(size_t windowSize);
+    /// Sets the window size for the navigation performance RMS errors
+    void setPerformanceWindowSize(size_t windowSize);
+    /// Sets the time gap after which differencing restarts
+    void setMaxTimeGap(double maxTimeGap);
+    /// Returns the heading rate residual [deg/s]
+    const RollingStatistics& getHeadingRateResidual() const;
+    /// Returns the horizontal velocity residual [m/s]
+    const RollingStatistics& getHorizontalVelocityResidual() const;
+    /// Returns the down velocity residual [m/s]
+    const RollingStatistics& getDownVelocityResidual() const;
+    /// Returns the longitudinal acceleration residual [m/s^2]
+    const RollingStatistics& getAccelerationResidual() const;
+    /// Returns the position RMS error [m]
+    const RollingStatistics& getPositionRMSError() const;
+    /// Returns the heading RMS error [deg]
+    const RollingStatistics& getHeadingRMSError() const;
+    /// Returns the last position RMS error over the previous window mean
+    double getPositionRMSErrorRatio() const;
+    /// Returns the last heading RMS error over the previous window mean
+    double getHeadingRMSErrorRatio() const;
+    /// Returns the number of non-finite samples rejected
+    size_t getNumRejectedSamples() const;
+    /// Returns whether a sample was rejected within the last window
+    bool hasRejectedSamples() const;
+    /** @}
+      */
+
+    /** \name Methods
+      @{
+      */
+    /// Adds a vehicle navigation solution
+    void addSolution(const VehicleNavigationSolution& vns);
+    /// Adds a vehicle navigation performance
+    void addPerformance(const VehicleNavigationPerformance& vnp);
+    /// Clears all the statistics
+    void clear();
+    /** @}
+      */
+
+  protected:
+    /** \name Protected methods
+      @{
+      */
+    /// Adds a sample and returns its ratio to the previous window mean
+    static double addRatioSample(RollingStatistics& statistics, double value);
+    /** @}
+      */
+
+    /** \name Protected members
+      @{
+      */
+    /// Time gap after which differencing restarts
+    double _maxTimeGap;
+    /// Heading rate residual
+    RollingStatistics _headingRateResidual;
+    /// Horizontal velocity residual
+    RollingStatistics _horizontalVelocityResidual;
+    /// Down velocity residual
+    RollingStatistics _downVelocityResidual;
+    /// Longitudinal acceleration residual
+    RollingStatistics _accelerationResidual;
+    /// Position RMS error
+    RollingStatistics _positionRMSError;
+    /// Heading RMS error
+    RollingStatistics _headingRMSError;
+    /// Last position RMS error ratio
+    double _positionRMSErrorRatio;
+    /// Last heading RMS error ratio
+    double _headingRMSErrorRatio;
+    /// Whether a previous solution is available
+    bool _hasLastSolution;
+    /// Last solution time
+    double _lastTime;
+    /// Last latitude
+    double _lastLatitude;
+    /// Last longitude
+    double _lastLongitude;
+    /// Last altitude
+    double _lastAltitude;
+    /// Last north velocity
+    double _lastNorthVelocity;
+    /// Last east velocity
+    double _lastEastVelocity;
+    /// Last down velocity
+    double _lastDownVelocity;
+    /// Last heading
+    double _lastHeading;
+    /// Last heading rate from the body angular rates
+    double _lastHeadingRate;
+    /// Last velocity along the heading, negative when reversing
+    double _lastLongitudinalSpeed;
+    /// Last longitudinal acceleration
+    double _lastAccLong;
+    /** @}
+      */
+
+  };
+
+}
+
+#endif // NAVIGATION_QUALITY_MONITOR_H
@@ -18,7 +18,15 @@
 
 #include "PosLvNode.h"
 
+#include <sys/stat.h>
+
+#include <ctime>
+
 #include <bitset>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
 
 #include <diagnostic_updater/publisher.h>
 
@@ -48,6 +56,10 @@
 #include "poslv/VehicleNavigationSolutionMsg.h"
 #include "poslv/VehicleNavigationPerformanceMsg.h"
 #include "poslv/TimeTaggedDMIDataMsg.h"
+#include "poslv/NavigationQualityMsg.h"
+
+#include "FramedTCPConnectionClient.h"
+#include "ColumnarLogWriter.h"
 
 namespace poslv {
 
@@ -57,6 +69,9 @@ namespace poslv {
 
   PosLvNode::PosLvNode(const ros::NodeHandle& nh) :
       _nodeHandle(nh),
+      _lastBatchSize(0),
+      _lastBatchParseTime(0),
+      _maxBatchParseTime(0),
       _alignStatus(8),
       _navStatus1(-1),
       _navStatus2(-1),
@@ -86,7 +101,11 @@ namespace poslv {
       _rtcm3Count(0),
       _rtcm9Count(0),
       _rtcm18Count(0),
-      _rtcm19Count(0) {
+      _rtcm19Count(0),
+      _qualityPacketCounter(0),
+      _vnsLogTable(0),
+      _vnpLogTable(0),
+      _dmiLogTable(0) {
     _gpsStatusMsgs[-1] = "Unknown";
     _gpsStatusMsgs[0] = "No data from receiver";
     _gpsStatusMsgs[1] = "Horizontal C/A mode";
@@ -122,37 +141,44 @@ namespace poslv {
     _iinStatusMsgs[6] = "Autonmous (C/A)";
     _iinStatusMsgs[7] = "GPS navigation solution";
     _iinStatusMsgs[8] = "No solution";
-    getParameters();
-    _vehicleNavigationSolutionPublisher =
-      _nodeHandle.advertise<poslv::VehicleNavigationSolutionMsg>(
-      "vehicle_navigation_solution", _queueDepth);
-    _vehicleNavigationPerformancePublisher =
-      _nodeHandle.advertise<poslv::VehicleNavigationPerformanceMsg>(
-      "vehicle_navigation_performance", _queueDepth);
-    _timeTaggedDMIDataPublisher =
-      _nodeHandle.advertise<poslv::TimeTaggedDMIDataMsg>(
-      "time_tagged_dmi_data", _queueDepth);
+    Parameters parameters;
+    getParameters(parameters);
+    std::string message;
+    if (!validateParameters(parameters, message))
+      throw std::invalid_argument("PosLvNode::PosLvNode(): " + message);
+    _parameters = parameters;
+    configureQualityMonitor();
+    advertisePublishers();
     _setDgpsService = _nodeHandle.advertiseService("set_dgps",
       &PosLvNode::setDgps, this);
+    _reloadParametersService = _nodeHandle.advertiseService(
+      "reload_parameters", &PosLvNode::reloadParameters, this);
     _updater.setHardwareID("POS LV 220");
     _updater.add("TCP connection", this, &PosLvNode::diagnoseTCPConnection);
     _updater.add("System status", this, &PosLvNode::diagnoseSystemStatus);
+    _updater.add("Navigation quality", this,
+      &PosLvNode::diagnoseNavigationQuality);
+    if (_parameters.mLoggingEnabled)
+      initLogging();
+    _updater.add("Logging", this, &PosLvNode::diagnoseLogging);
     _vnsFreq = std::make_shared<diagnostic_updater::HeaderlessTopicDiagnostic>(
       "vehicle_navigation_solution", _updater,
-      diagnostic_updater::FrequencyStatusParam(&_vnsMinFreq, &_vnsMaxFreq,
-      0.1, 10));
+      diagnostic_updater::FrequencyStatusParam(&_parameters.mVnsMinFreq,
+      &_parameters.mVnsMaxFreq, 0.1, 10));
     _vnpFreq = std::make_shared<diagnostic_updater::HeaderlessTopicDiagnostic>(
       "vehicle_navigation_performance", _updater,
-      diagnostic_updater::FrequencyStatusParam(&_vnpMinFreq, &_vnpMaxFreq,
-      0.1, 10));
+      diagnostic_updater::FrequencyStatusParam(&_parameters.mVnpMinFreq,
+      &_parameters.mVnpMaxFreq, 0.1, 10));
     _dmiFreq = std::make_shared<diagnostic_updater::HeaderlessTopicDiagnostic>(
       "time_tagged_dmi_data", _updater,
-      diagnostic_updater::FrequencyStatusParam(&_dmiMinFreq, &_dmiMaxFreq,
-      0.1, 10));
+      diagnostic_updater::FrequencyStatusParam(&_parameters.mDmiMinFreq,
+      &_parameters.mDmiMaxFreq, 0.1, 10));
     _updater.force_update();
   }
 
   PosLvNode::~PosLvNode() {
+    if (_logWriterTeardown.joinable())
+      _logWriterTeardown.join();
   }
 
 /******************************************************************************/
@@ -168,7 +194,8 @@ namespace poslv {
       response.message = "Unkown mode";
     }
     else {
-      TCPConnectionClient tcpConnection(_deviceIpStr, _deviceControlPort);
+      TCPConnectionClient tcpConnection(_parameters.mDeviceIpStr,
+        _parameters.mDeviceControlPort);
       POSLVComTCP device(tcpConnection);
       std::shared_ptr<Packet> ctrlPacket(
         Factory<uint16_t, Message>::getInstance().create(90));
@@ -217,12 +244,140 @@ namespace poslv {
     return true;
   }
 
+  bool PosLvNode::reloadParameters(poslv::ReloadParameters::Request&,
+      poslv::ReloadParameters::Response& response) {
+    // called from ros::spinOnce() in spin(), hence between two batches
+    Parameters parameters;
+    getParameters(parameters);
+    std::string message;
+    if (!validateParameters(parameters, message)) {
+      response.response = false;
+      response.message = "Parameters rejected, nothing changed: " + message;
+      ROS_WARN_STREAM(response.message);
+      return true;
+    }
+    // every parameter is applied, only the rebuilds depend on the changes
+    const Parameters previous = _parameters;
+    _parameters = parameters;
+    const Parameters& current = _parameters;
+    std::string rebuilt;
+    if (current.mQueueDepth != previous.mQueueDepth) {
+      advertisePublishers();
+      rebuilt += " publishers";
+    }
+    // the frequency limits are read through pointers, only restart the window
+    if (current.mVnsMinFreq != previous.mVnsMinFreq ||
+        current.mVnsMaxFreq != previous.mVnsMaxFreq) {
+      _vnsFreq->clear_window();
+      rebuilt += " vns_frequency";
+    }
+    if (current.mVnpMinFreq != previous.mVnpMinFreq ||
+        current.mVnpMaxFreq != previous.mVnpMaxFreq) {
+      _vnpFreq->clear_window();
+      rebuilt += " vnp_frequency";
+    }
+    if (current.mDmiMinFreq != previous.mDmiMinFreq ||
+        current.mDmiMaxFreq != previous.mDmiMaxFreq) {
+      _dmiFreq->clear_window();
+      rebuilt += " dmi_frequency";
+    }
+    if (current.mQualityWindowSize != previous.mQualityWindowSize) {
+      _qualityMonitor.setWindowSize(current.mQualityWindowSize);
+      rebuilt += " quality_window";
+    }
+    if (current.mQualityPerformanceWindowSize !=
+        previous.mQualityPerformanceWindowSize) {
+      _qualityMonitor.setPerformanceWindowSize(
+        current.mQualityPerformanceWindowSize);
+      rebuilt += " quality_performance_window";
+    }
+    if (current.mQualityMaxTimeGap != previous.mQualityMaxTimeGap)
+      _qualityMonitor.setMaxTimeGap(current.mQualityMaxTimeGap);
+    if (_tcpConnection) {
+      if (current.mDeviceIpStr != previous.mDeviceIpStr ||
+          current.mDevicePort != previous.mDevicePort) {
+        connect();
+        rebuilt += " connection";
+      }
+      else {
+        // the read settings apply to the open connection without dropping it
+        if (current.mReadTimeout != previous.mReadTimeout)
+          _tcpConnection->setTimeout(current.mReadTimeout);
+        if (current.mReadBufferSize != previous.mReadBufferSize)
+          _tcpConnection->setBufferSize(current.mReadBufferSize);
+      }
+    }
+    if (current.mLoggingEnabled != previous.mLoggingEnabled ||
+        current.mLoggingDirectory != previous.mLoggingDirectory ||
+        current.mLoggingChunkSize != previous.mLoggingChunkSize ||
+        current.mLoggingMaxQueuedChunks != previous.mLoggingMaxQueuedChunks ||
+        current.mLoggingFlushPeriod != previous.mLoggingFlushPeriod) {
+      retireLogWriter();
+      if (current.mLoggingEnabled)
+        initLogging();
+      rebuilt += " logging";
+    }
+    response.response = true;
+    response.message = rebuilt.empty() ? "Parameters reloaded" :
+      "Parameters reloaded, rebuilt:" + rebuilt;
+    ROS_INFO_STREAM(response.message);
+    return true;
+  }
+
+  void PosLvNode::advertisePublishers() {
+    // a publisher keeps the queue size it was advertised with, so the topics
+    // are shut down first and subscribers reconnect to the new publications
+    _vehicleNavigationSolutionPublisher.shutdown();
+    _vehicleNavigationPerformancePublisher.shutdown();
+    _timeTaggedDMIDataPublisher.shutdown();
+    _navigationQualityPublisher.shutdown();
+    _vehicleNavigationSolutionPublisher =
+      _nodeHandle.advertise<poslv::VehicleNavigationSolutionMsg>(
+      "vehicle_navigation_solution", _parameters.mQueueDepth);
+    _vehicleNavigationPerformancePublisher =
+      _nodeHandle.advertise<poslv::VehicleNavigationPerformanceMsg>(
+      "vehicle_navigation_performance", _parameters.mQueueDepth);
+    _timeTaggedDMIDataPublisher =
+      _nodeHandle.advertise<poslv::TimeTaggedDMIDataMsg>(
+      "time_tagged_dmi_data", _parameters.mQueueDepth);
+    _navigationQualityPublisher =
+      _nodeHandle.advertise<poslv::NavigationQualityMsg>(
+      "navigation_quality", _parameters.mQueueDepth);
+  }
+
+  void PosLvNode::configureQualityMonitor() {
+    _qualityMonitor.setWindowSize(_parameters.mQualityWindowSize);
+    _qualityMonitor.setPerformanceWindowSize(
+      _parameters.mQualityPerformanceWindowSize);
+    _qualityMonitor.setMaxTimeGap(_parameters.mQualityMaxTimeGap);
+  }
+
+  void PosLvNode::connect() {
+    _device.reset();
+    _tcpConnection = std::make_shared<FramedTCPConnectionClient>(
+      _parameters.mDeviceIpStr, _parameters.mDevicePort,
+      _parameters.mReadTimeout, _parameters.mReadBufferSize);
+    _device = std::make_shared<POSLVComTCP>(*_tcpConnection);
+  }
+
+  void PosLvNode::retireLogWriter() {
+    // the writer destructor flushes and joins its thread, keep it off spin()
+    if (_logWriterTeardown.joinable())
+      _logWriterTeardown.join();
+    if (!_logWriter)
+      return;
+    _logWriterTeardown = std::thread(
+      [](std::shared_ptr<ColumnarLogWriter> logWriter) { logWriter.reset(); },
+      std::move(_logWriter));
+    _logWriter.reset();
+  }
+
   void PosLvNode::publishVehicleNavigationSolution(const ros::Time& timestamp,
       const VehicleNavigationSolution& vns) {
     if (_vehicleNavigationSolutionPublisher.getNumSubscribers() > 0) {
       auto vnsMsg = boost::make_shared<poslv::VehicleNavigationSolutionMsg>();
       vnsMsg->header.stamp = timestamp;
-      vnsMsg->header.frame_id = _frameId;
+      vnsMsg->header.frame_id = _parameters.mFrameId;
       vnsMsg->header.seq = _vnsPacketCounter++;
       vnsMsg->timeDistance.time1 = vns.mTimeDistance.mTime1;
       vnsMsg->timeDistance.time2 = vns.mTimeDistance.mTime2;
@@ -259,7 +414,7 @@ namespace poslv {
       auto vnpMsg =
         boost::make_shared<poslv::VehicleNavigationPerformanceMsg>();
       vnpMsg->header.stamp = timestamp;
-      vnpMsg->header.frame_id = _frameId;
+      vnpMsg->header.frame_id = _parameters.mFrameId;
       vnpMsg->header.seq = _vnpPacketCounter++;
       vnpMsg->timeDistance.time1 = vnp.mTimeDistance.mTime1;
       vnpMsg->timeDistance.time2 = vnp.mTimeDistance.mTime2;
@@ -288,7 +443,7 @@ namespace poslv {
     if (_timeTaggedDMIDataPublisher.getNumSubscribers() > 0) {
       auto dmiMsg = boost::make_shared<poslv::TimeTaggedDMIDataMsg>();
       dmiMsg->header.stamp = timestamp;
-      dmiMsg->header.frame_id = _frameId;
+      dmiMsg->header.frame_id = _parameters.mFrameId;
       dmiMsg->header.seq = _dmiPacketCounter++;
       dmiMsg->timeDistance.time1 = dmi.mTimeDistance.mTime1;
       dmiMsg->timeDistance.time2 = dmi.mTimeDistance.mTime2;
@@ -306,6 +461,73 @@ namespace poslv {
     _dmiFreq->tick();
   }
 
+  void PosLvNode::publishNavigationQuality(const ros::Time& timestamp) {
+    if (_navigationQualityPublisher.getNumSubscribers() > 0) {
+      auto qualityMsg = boost::make_shared<poslv::NavigationQualityMsg>();
+      qualityMsg->header.stamp = timestamp;
+      qualityMsg->header.frame_id = _parameters.mFrameId;
+      qualityMsg->header.seq = _qualityPacketCounter++;
+      const RollingStatistics& headingRate =
+        _qualityMonitor.getHeadingRateResidual();
+      const RollingStatistics& horizontalVelocity =
+        _qualityMonitor.getHorizontalVelocityResidual();
+      const RollingStatistics& downVelocity =
+        _qualityMonitor.getDownVelocityResidual();
+      const RollingStatistics& acceleration =
+        _qualityMonitor.getAccelerationResidual();
+      qualityMsg->headingRateResidual = headingRate.getLast();
+      qualityMsg->headingRateResidualRMS = headingRate.getRMS();
+      qualityMsg->horizontalVelocityResidual = horizontalVelocity.getLast();
+      qualityMsg->horizontalVelocityResidualRMS = horizontalVelocity.getRMS();
+      qualityMsg->downVelocityResidual = downVelocity.getLast();
+      qualityMsg->downVelocityResidualRMS = downVelocity.getRMS();
+      qualityMsg->accelerationResidual = acceleration.getLast();
+      qualityMsg->accelerationResidualRMS = acceleration.getRMS();
+      qualityMsg->positionRMSError =
+        _qualityMonitor.getPositionRMSError().getLast();
+      qualityMsg->positionRMSErrorRatio =
+        _qualityMonitor.getPositionRMSErrorRatio();
+      qualityMsg->headingRMSError =
+        _qualityMonitor.getHeadingRMSError().getLast();
+      qualityMsg->headingRMSErrorRatio =
+        _qualityMonitor.getHeadingRMSErrorRatio();
+      std::string message;
+      qualityMsg->level = checkNavigationQuality(message);
+      _navigationQualityPublisher.publish(qualityMsg);
+    }
+  }
+
+  uint8_t PosLvNode::checkNavigationQuality(std::string& message) const {
+    uint8_t level = diagnostic_msgs::DiagnosticStatus::OK;
+    message.clear();
+    auto check = [&](bool failed, const std::string& reason) {
+      if (failed) {
+        level = diagnostic_msgs::DiagnosticStatus::WARN;
+        message += (message.empty() ? "" : ", ") + reason;
+      }
+    };
+    check(_qualityMonitor.getHeadingRateResidual().getRMS() >
+      _parameters.mMaxHeadingRateResidual,
+      "heading rate inconsistent with angular rates");
+    check(_qualityMonitor.getHorizontalVelocityResidual().getRMS() >
+      _parameters.mMaxVelocityResidual ||
+      _qualityMonitor.getDownVelocityResidual().getRMS() >
+      _parameters.mMaxVelocityResidual, "position inconsistent with velocity");
+    check(_qualityMonitor.getAccelerationResidual().getRMS() >
+      _parameters.mMaxAccelerationResidual,
+      "speed inconsistent with acceleration");
+    check(_qualityMonitor.getPositionRMSErrorRatio() >
+      _parameters.mMaxRMSErrorRatio, "position RMS error jump");
+    check(_qualityMonitor.getHeadingRMSErrorRatio() >
+      _parameters.mMaxRMSErrorRatio, "heading RMS error jump");
+    check(_qualityMonitor.hasRejectedSamples(), "non-finite samples rejected");
+    if (message.empty())
+      message = "Consistent navigation solution";
+    else
+      message[0] = std::toupper(message[0]);
+    return level;
+  }
+
   void PosLvNode::diagnoseTCPConnection(
       diagnostic_updater::DiagnosticStatusWrapper& status) {
     if (_tcpConnection && _tcpConnection->isOpen()) {
@@ -315,6 +537,19 @@ namespace poslv {
         status.add("Inter VNP packet time [s]", _lastInterVnpTime);
       if (_lastInterDmiTime)
         status.add("Inter DMI packet time [s]", _lastInterDmiTime);
+      if (_tcpConnection->getNumReads()) {
+        status.add("Packets per read",
+          static_cast<double>(_tcpConnection->getNumFrames()) /
+          _tcpConnection->getNumReads());
+        status.add("Bytes per read",
+          static_cast<double>(_tcpConnection->getNumBytes()) /
+          _tcpConnection->getNumReads());
+      }
+      status.add("Discarded bytes", _tcpConnection->getNumDiscardedBytes());
+      status.add("Rejected packets", _tcpConnection->getNumRejectedFrames());
+      status.add("Last batch size", _lastBatchSize);
+      status.add("Last batch parse time [ms]", _lastBatchParseTime * 1e3);
+      status.add("Maximum batch parse time [ms]", _maxBatchParseTime * 1e3);
       status.summaryf(diagnostic_msgs::DiagnosticStatus::OK,
         "TCP connection opened on %s:%d.",
         _tcpConnection->getServerIP().c_str(),
@@ -322,7 +557,8 @@ namespace poslv {
     }
     else
      status.summaryf(diagnostic_msgs::DiagnosticStatus::ERROR,
-      "TCP connection closed on %s:%d.", _deviceIpStr.c_str(), _devicePort);
+      "TCP connection closed on %s:%d.", _parameters.mDeviceIpStr.c_str(),
+      _parameters.mDevicePort);
   }
 
   void PosLvNode::diagnoseSystemStatus(
@@ -355,125 +591,459 @@ namespace poslv {
         "Incomplete navigation solution");
   }
 
+  void PosLvNode::diagnoseNavigationQuality(
+      diagnostic_updater::DiagnosticStatusWrapper& status) {
+    status.add("Heading rate residual RMS [deg/s]",
+      _qualityMonitor.getHeadingRateResidual().getRMS());
+    status.add("Horizontal velocity residual RMS [m/s]",
+      _qualityMonitor.getHorizontalVelocityResidual().getRMS());
+    status.add("Down velocity residual RMS [m/s]",
+      _qualityMonitor.getDownVelocityResidual().getRMS());
+    status.add("Acceleration residual RMS [m/s^2]",
+      _qualityMonitor.getAccelerationResidual().getRMS());
+    status.add("Position RMS error [m]",
+      _qualityMonitor.getPositionRMSError().getLast());
+    status.add("Position RMS error ratio",
+      _qualityMonitor.getPositionRMSErrorRatio());
+    status.add("Heading RMS error [deg]",
+      _qualityMonitor.getHeadingRMSError().getLast());
+    status.add("Heading RMS error ratio",
+      _qualityMonitor.getHeadingRMSErrorRatio());
+    status.add("Rejected samples", _qualityMonitor.getNumRejectedSamples());
+    std::string message;
+    const uint8_t level = checkNavigationQuality(message);
+    status.summary(level, message);
+  }
+
+  void PosLvNode::diagnoseLogging(
+      diagnostic_updater::DiagnosticStatusWrapper& status) {
+    if (!_parameters.mLoggingEnabled) {
+      status.summaryf(diagnostic_msgs::DiagnosticStatus::OK,
+        "Logging disabled.");
+      return;
+    }
+    if (!_logWriter) {
+      status.summaryf(diagnostic_msgs::DiagnosticStatus::ERROR,
+        "Logging disabled after an error.");
+      return;
+    }
+    const size_t numBytes = _logWriter->getNumBytes();
+    status.add("Directory", _logWriter->getDirectory());
+    status.add("Rows written", _logWriter->getNumRows());
+    status.add("Bytes written", numBytes);
+    if (numBytes)
+      status.add("Compression ratio",
+        static_cast<double>(_logWriter->getNumRawBytes()) / numBytes);
+    status.add("Dropped chunks", _logWriter->getNumDroppedChunks());
+    status.add("Write errors", _logWriter->getNumWriteErrors());
+    if (_logWriter->getNumWriteErrors())
+      status.summaryf(diagnostic_msgs::DiagnosticStatus::ERROR,
+        "Log writing failed in %s.", _logWriter->getDirectory().c_str());
+    else if (_logWriter->getNumDroppedChunks())
+      status.summaryf(diagnostic_msgs::DiagnosticStatus::WARN,
+        "Log chunks dropped in %s.", _logWriter->getDirectory().c_str());
+    else
+      status.summaryf(diagnostic_msgs::DiagnosticStatus::OK,
+        "Logging to %s.", _logWriter->getDirectory().c_str());
+  }
+
+  void PosLvNode::initLogging() {
+    char runName[32];
+    const time_t now = time(0);
+    struct tm localNow;
+    localtime_r(&now, &localNow);
+    strftime(runName, sizeof(runName), "%Y-%m-%d-%H-%M-%S", &localNow);
+    std::string directory = _parameters.mLoggingDirectory + "/" + runName;
+    struct stat info;
+    for (size_t i = 1; !stat(directory.c_str(), &info); ++i) {
+      std::ostringstream suffixed;
+      suffixed << _parameters.mLoggingDirectory << "/" << runName << "-" << i;
+      directory = suffixed.str();
+    }
+    typedef ColumnarLogColumn Column;
+    std::vector<Column> timeDistance;
+    timeDistance.push_back(Column("stamp", Column::integer));
+    timeDistance.push_back(Column("time1", Column::float64));
+    timeDistance.push_back(Column("time2", Column::float64));
+    timeDistance.push_back(Column("distanceTag", Column::float64));
+    timeDistance.push_back(Column("timeType", Column::integer, 1));
+    timeDistance.push_back(Column("distanceType", Column::integer, 1));
+    try {
+      _logWriter = std::make_shared<ColumnarLogWriter>(directory,
+        _parameters.mLoggingChunkSize, _parameters.mLoggingMaxQueuedChunks,
+        _parameters.mLoggingFlushPeriod);
+      std::vector<Column> vns(timeDistance);
+      vns.push_back(Column("latitude", Column::float64));
+      vns.push_back(Column("longitude", Column::float64));
+      vns.push_back(Column("altitude", Column::float64));
+      vns.push_back(Column("northVelocity", Column::float32));
+      vns.push_back(Column("eastVelocity", Column::float32));
+      vns.push_back(Column("downVelocity", Column::float32));
+      vns.push_back(Column("roll", Column::float64));
+      vns.push_back(Column("pitch", Column::float64));
+      vns.push_back(Column("heading", Column::float64));
+      vns.push_back(Column("wanderAngle", Column::float64));
+      vns.push_back(Column("trackAngle", Column::float32));
+      vns.push_back(Column("speed", Column::float32));
+      vns.push_back(Column("angularRateLong", Column::float32));
+      vns.push_back(Column("angularRateTrans", Column::float32));
+      vns.push_back(Column("angularRateDown", Column::float32));
+      vns.push_back(Column("accLong", Column::float32));
+      vns.push_back(Column("accTrans", Column::float32));
+      vns.push_back(Column("accDown", Column::float32));
+      vns.push_back(Column("alignementStatus", Column::integer, 1));
+      _vnsLogTable = _logWriter->addTable("vehicle_navigation_solution", vns);
+      std::vector<Column> vnp(timeDistance);
+      vnp.push_back(Column("northPositionRMSError", Column::float32));
+      vnp.push_back(Column("eastPositionRMSError", Column::float32));
+      vnp.push_back(Column("downPositionRMSError", Column::float32));
+      vnp.push_back(Column("northVelocityRMSError", Column::float32));
+      vnp.push_back(Column("eastVelocityRMSError", Column::float32));
+      vnp.push_back(Column("downVelocityRMSError", Column::float32));
+      vnp.push_back(Column("rollRMSError", Column::float32));
+      vnp.push_back(Column("pitchRMSError", Column::float32));
+      vnp.push_back(Column("headingRMSError", Column::float32));
+      vnp.push_back(Column("errorEllipsoidSemiMajor", Column::float32));
+      vnp.push_back(Column("errorEllipsoidSemiMinor", Column::float32));
+      vnp.push_back(Column("errorEllipsoidOrientation", Column::float32));
+      _vnpLogTable = _logWriter->addTable("vehicle_navigation_performance",
+        vnp);
+      std::vector<Column> dmi(timeDistance);
+      dmi.push_back(Column("signedDistanceTraveled", Column::float64));
+      dmi.push_back(Column("unsignedDistanceTraveled", Column::float64));
+      dmi.push_back(Column("dmiScaleFactor", Column::integer, 2));
+      dmi.push_back(Column("dataStatus", Column::integer, 1));
+      dmi.push_back(Column("dmiType", Column::integer, 1));
+      dmi.push_back(Column("dmiDataRate", Column::integer, 1));
+      _dmiLogTable = _logWriter->addTable("time_tagged_dmi_data", dmi);
+    }
+    catch (const IOException& e) {
+      ROS_ERROR_STREAM("IOException: " << e.what());
+      _logWriter.reset();
+    }
+    catch (const SystemException& e) {
+      ROS_ERROR_STREAM("SystemException: " << e.what());
+      _logWriter.reset();
+    }
+  }
+
+  void PosLvNode::logVehicleNavigationSolution(const ros::Time& timestamp,
+      const VehicleNavigationSolution& vns) {
+    _logWriter->beginRow(_vnsLogTable);
+    _logWriter->addInteger(timestamp.toNSec());
+    _logWriter->addReal(vns.mTimeDistance.mTime1);
+    _logWriter->addReal(vns.mTimeDistance.mTime2);
+    _logWriter->addReal(vns.mTimeDistance.mDistanceTag);
+    _logWriter->addInteger(vns.mTimeDistance.mTimeType);
+    _logWriter->addInteger(vns.mTimeDistance.mDistanceType);
+    _logWriter->addReal(vns.mLatitude);
+    _logWriter->addReal(vns.mLongitude);
+    _logWriter->addReal(vns.mAltitude);
+    _logWriter->addReal(vns.mNorthVelocity);
+    _logWriter->addReal(vns.mEastVelocity);
+    _logWriter->addReal(vns.mDownVelocity);
+    _logWriter->addReal(vns.mRoll);
+    _logWriter->addReal(vns.mPitch);
+    _logWriter->addReal(vns.mHeading);
+    _logWriter->addReal(vns.mWanderAngle);
+    _logWriter->addReal(vns.mTrackAngle);
+    _logWriter->addReal(vns.mSpeed);
+    _logWriter->addReal(vns.mAngularRateLong);
+    _logWriter->addReal(vns.mAngularRateTrans);
+    _logWriter->addReal(vns.mAngularRateDown);
+    _logWriter->addReal(vns.mAccLong);
+    _logWriter->addReal(vns.mAccTrans);
+    _logWriter->addReal(vns.mAccDown);
+    _logWriter->addInteger(vns.mAlignementStatus);
+    _logWriter->endRow();
+  }
+
+  void PosLvNode::logVehicleNavigationPerformance(const ros::Time& timestamp,
+      const VehicleNavigationPerformance& vnp) {
+    _logWriter->beginRow(_vnpLogTable);
+    _logWriter->addInteger(timestamp.toNSec());
+    _logWriter->addReal(vnp.mTimeDistance.mTime1);
+    _logWriter->addReal(vnp.mTimeDistance.mTime2);
+    _logWriter->addReal(vnp.mTimeDistance.mDistanceTag);
+    _logWriter->addInteger(vnp.mTimeDistance.mTimeType);
+    _logWriter->addInteger(vnp.mTimeDistance.mDistanceType);
+    _logWriter->addReal(vnp.mNorthPositionRMSError);
+    _logWriter->addReal(vnp.mEastPositionRMSError);
+    _logWriter->addReal(vnp.mDownPositionRMSError);
+    _logWriter->addReal(vnp.mNorthVelocityRMSError);
+    _logWriter->addReal(vnp.mEastVelocityRMSError);
+    _logWriter->addReal(vnp.mDownVelocityRMSError);
+    _logWriter->addReal(vnp.mRollRMSError);
+    _logWriter->addReal(vnp.mPitchRMSError);
+    _logWriter->addReal(vnp.mHeadingRMSError);
+    _logWriter->addReal(vnp.mErrorEllipsoidSemiMajor);
+    _logWriter->addReal(vnp.mErrorEllipsoidSemiMinor);
+    _logWriter->addReal(vnp.mErrorEllipsoidOrientation);
+    _logWriter->endRow();
+  }
+
+  void PosLvNode::logTimeTaggedDMIData(const ros::Time& timestamp,
+      const TimeTaggedDMIData& dmi) {
+    _logWriter->beginRow(_dmiLogTable);
+    _logWriter->addInteger(timestamp.toNSec());
+    _logWriter->addReal(dmi.mTimeDistance.mTime1);
+    _logWriter->addReal(dmi.mTimeDistance.mTime2);
+    _logWriter->addReal(dmi.mTimeDistance.mDistanceTag);
+    _logWriter->addInteger(dmi.mTimeDistance.mTimeType);
+    _logWriter->addInteger(dmi.mTimeDistance.mDistanceType);
+    _logWriter->addReal(dmi.mSignedDistanceTraveled);
+    _logWriter->addReal(dmi.mUnsignedDistanceTraveled);
+    _logWriter->addInteger(dmi.mDMIScaleFactor);
+    _logWriter->addInteger(dmi.mDataStatus);
+    _logWriter->addInteger(dmi.mDMIType);
+    _logWriter->addInteger(dmi.mDMIDataRate);
+    _logWriter->endRow();
+  }
+
+  void PosLvNode::processGroup(const ros::Time& timestamp,
+      const Group& group) {
+    if (group.instanceOf<VehicleNavigationSolution>()) {
+      const VehicleNavigationSolution& vns =
+        group.typeCast<VehicleNavigationSolution>();
+      publishVehicleNavigationSolution(timestamp, vns);
+      if (_logWriter)
+        logVehicleNavigationSolution(timestamp, vns);
+      _qualityMonitor.addSolution(vns);
+      publishNavigationQuality(timestamp);
+      if (_lastVnsTimestamp)
+        _lastInterVnsTime = vns.mTimeDistance.mTime2 - _lastVnsTimestamp;
+      _lastVnsTimestamp = vns.mTimeDistance.mTime2;
+      _alignStatus = vns.mAlignementStatus;
+    }
+    else if (group.instanceOf<VehicleNavigationPerformance>()) {
+      const VehicleNavigationPerformance& vnp =
+        group.typeCast<VehicleNavigationPerformance>();
+      publishVehicleNavigationPerformance(timestamp, vnp);
+      if (_logWriter)
+        logVehicleNavigationPerformance(timestamp, vnp);
+      _qualityMonitor.addPerformance(vnp);
+      if (_lastVnpTimestamp)
+        _lastInterVnpTime = vnp.mTimeDistance.mTime2 - _lastVnpTimestamp;
+      _lastVnpTimestamp = vnp.mTimeDistance.mTime2;
+    }
+    else if (group.instanceOf<TimeTaggedDMIData>()) {
+      const TimeTaggedDMIData& dmi = group.typeCast<TimeTaggedDMIData>();
+      publishTimeTaggedDMIData(timestamp, dmi);
+      if (_logWriter)
+        logTimeTaggedDMIData(timestamp, dmi);
+      if (_lastDmiTimestamp)
+        _lastInterDmiTime = dmi.mTimeDistance.mTime2 - _lastDmiTimestamp;
+      _lastDmiTimestamp = dmi.mTimeDistance.mTime2;
+    }
+    else if (group.instanceOf<PrimaryGPSStatus>()) {
+      const PrimaryGPSStatus& gps = group.typeCast<PrimaryGPSStatus>();
+      _navStatus1 = gps.mNavigationSolutionStatus;
+    }
+    else if (group.instanceOf<SecondaryGPSStatus>()) {
+      const SecondaryGPSStatus& gps =
+        group.typeCast<SecondaryGPSStatus>();
+      _navStatus2 = gps.mNavigationSolutionStatus;
+    }
+    else if (group.instanceOf<GAMSSolutionStatus>()) {
+      const GAMSSolutionStatus& gams =
+        group.typeCast<GAMSSolutionStatus>();
+      _gamsStatus = gams.mSolutionStatus;
+    }
+    else if (group.instanceOf<IINSolutionStatus>()) {
+      const IINSolutionStatus& iin =
+        group.typeCast<IINSolutionStatus>();
+      _iinStatus = iin.mIINProcessingStatus;
+    }
+    else if (group.instanceOf<GeneralStatusFDIR>()) {
+      const GeneralStatusFDIR& stat =
+        group.typeCast<GeneralStatusFDIR>();
+      _generalStatusA = stat.mGeneralStatusA;
+      _generalStatusB = stat.mGeneralStatusB;
+      _generalStatusC = stat.mGeneralStatusC;
+      _fdirLevel1Status = stat.mFDIRLevel1Status;
+      _fdirLevel2Status = stat.mFDIRLevel2Status;
+      _fdirLevel4Status = stat.mFDIRLevel4Status;
+      _fdirLevel5Status = stat.mFDIRLevel5Status;
+      std::bitset<32> statusC(_generalStatusC);
+      if (statusC.test(18))
+        _rtcm1Count++;
+      if (statusC.test(19))
+        _rtcm3Count++;
+      if (statusC.test(20))
+        _rtcm9Count++;
+      if (statusC.test(21))
+        _rtcm18Count++;
+      if (statusC.test(22))
+        _rtcm19Count++;
+      if (statusC.test(23))
+        _cmr0Count++;
+      if (statusC.test(24))
+        _cmr1Count++;
+      if (statusC.test(25))
+        _cmr2Count++;
+      if (statusC.test(26))
+        _cmr94Count++;
+    }
+  }
+
   void PosLvNode::spin() {
-    _tcpConnection = std::make_shared<TCPConnectionClient>(_deviceIpStr,
-      _devicePort);
-    POSLVComTCP device(*_tcpConnection);
+    connect();
     Timer timer;
     while (_nodeHandle.ok()) {
       try {
-        std::shared_ptr<Packet> packet = device.readPacket();
-        const ros::Time timestamp = ros::Time::now();
-        if (packet->instanceOfGroup()) {
-          const Group& group = packet->groupCast();
-          if (group.instanceOf<VehicleNavigationSolution>()) {
-            const VehicleNavigationSolution& vns =
-              group.typeCast<VehicleNavigationSolution>();
-            publishVehicleNavigationSolution(timestamp, vns);
-            if (_lastVnsTimestamp)
-              _lastInterVnsTime = vns.mTimeDistance.mTime2 - _lastVnsTimestamp;
-            _lastVnsTimestamp = vns.mTimeDistance.mTime2;
-            _alignStatus = vns.mAlignementStatus;
-          }
-          else if (group.instanceOf<VehicleNavigationPerformance>()) {
-            const VehicleNavigationPerformance& vnp =
-              group.typeCast<VehicleNavigationPerformance>();
-            publishVehicleNavigationPerformance(timestamp, vnp);
-            if (_lastVnpTimestamp)
-              _lastInterVnpTime = vnp.mTimeDistance.mTime2 - _lastVnpTimestamp;
-            _lastVnpTimestamp = vnp.mTimeDistance.mTime2;
-          }
-          else if (group.instanceOf<TimeTaggedDMIData>()) {
-            const TimeTaggedDMIData& dmi = group.typeCast<TimeTaggedDMIData>();
-            publishTimeTaggedDMIData(timestamp, dmi);
-            if (_lastDmiTimestamp)
-              _lastInterDmiTime = dmi.mTimeDistance.mTime2 - _lastDmiTimestamp;
-            _lastDmiTimestamp = dmi.mTimeDistance.mTime2;
-          }
-          else if (group.instanceOf<PrimaryGPSStatus>()) {
-            const PrimaryGPSStatus& gps = group.typeCast<PrimaryGPSStatus>();
-            _navStatus1 = gps.mNavigationSolutionStatus;
-          }
-          else if (group.instanceOf<SecondaryGPSStatus>()) {
-            const SecondaryGPSStatus& gps =
-              group.typeCast<SecondaryGPSStatus>();
-            _navStatus2 = gps.mNavigationSolutionStatus;
+        _tcpConnection->fill();
+        const ros::WallTime batchStart = ros::WallTime::now();
+        size_t batchSize = 0;
+        while (_tcpConnection->nextFrame()) {
+          std::shared_ptr<Packet> packet;
+          try {
+            packet = _device->readPacket();
           }
-          else if (group.instanceOf<GAMSSolutionStatus>()) {
-            const GAMSSolutionStatus& gams =
-              group.typeCast<GAMSSolutionStatus>();
-            _gamsStatus = gams.mSolutionStatus;
+          catch (const TypeCreationException<unsigned short>& e) {
           }
-          else if (group.instanceOf<IINSolutionStatus>()) {
-            const IINSolutionStatus& iin =
-              group.typeCast<IINSolutionStatus>();
-            _iinStatus = iin.mIINProcessingStatus;
-          }
-          else if (group.instanceOf<GeneralStatusFDIR>()) {
-            const GeneralStatusFDIR& stat =
-              group.typeCast<GeneralStatusFDIR>();
-            _generalStatusA = stat.mGeneralStatusA;
-            _generalStatusB = stat.mGeneralStatusB;
-            _generalStatusC = stat.mGeneralStatusC;
-            _fdirLevel1Status = stat.mFDIRLevel1Status;
-            _fdirLevel2Status = stat.mFDIRLevel2Status;
-            _fdirLevel4Status = stat.mFDIRLevel4Status;
-            _fdirLevel5Status = stat.mFDIRLevel5Status;
-            std::bitset<32> statusC(_generalStatusC);
-            if (statusC.test(18))
-              _rtcm1Count++;
-            if (statusC.test(19))
-              _rtcm3Count++;
-            if (statusC.test(20))
-              _rtcm9Count++;
-            if (statusC.test(21))
-              _rtcm18Count++;
-            if (statusC.test(22))
-              _rtcm19Count++;
-            if (statusC.test(23))
-              _cmr0Count++;
-            if (statusC.test(24))
-              _cmr1Count++;
-            if (statusC.test(25))
-              _cmr2Count++;
-            if (statusC.test(26))
-              _cmr94Count++;
+          catch (const IOException& e) {
+            // a malformed packet must not stall the ones buffered behind it
+            ROS_WARN_STREAM_THROTTLE(1, "Rejected packet: " << e.what());
+            _tcpConnection->rejectFrame();
           }
+          if (packet && packet->instanceOfGroup())
+            processGroup(ros::Time::now(), packet->groupCast());
+          batchSize++;
         }
+        _lastBatchSize = batchSize;
+        _lastBatchParseTime = (ros::WallTime::now() - batchStart).toSec();
+        if (_lastBatchParseTime > _maxBatchParseTime)
+          _maxBatchParseTime = _lastBatchParseTime;
       }
       catch (const IOException& e) {
         ROS_WARN_STREAM("IOException: " << e.what());
-        ROS_WARN_STREAM("Retrying in " << _retryTimeout << " [s]");
-        timer.sleep(_retryTimeout);
+        ROS_WARN_STREAM("Retrying in " << _parameters.mRetryTimeout << " [s]");
+        timer.sleep(_parameters.mRetryTimeout);
       }
       catch (const SystemException& e) {
         ROS_WARN_STREAM("SystemException: " << e.what());
-        ROS_WARN_STREAM("Retrying in " << _retryTimeout << " [s]");
-        timer.sleep(_retryTimeout);
-      }
-      catch (const TypeCreationException<unsigned short>& e) {
+        ROS_WARN_STREAM("Retrying in " << _parameters.mRetryTimeout << " [s]");
+        timer.sleep(_parameters.mRetryTimeout);
       }
+      // slow tables reach the disk even when no rows or bytes arrive
+      if (_logWriter)
+        _logWriter->flushExpired();
       _updater.update();
       ros::spinOnce();
     }
   }
 
-  void PosLvNode::getParameters() {
-    _nodeHandle.param<std::string>("ros/frame_id", _frameId,
+  void PosLvNode::getParameters(Parameters& parameters) const {
+    _nodeHandle.param<std::string>("ros/frame_id", parameters.mFrameId,
       "/poslv_link");
-    _nodeHandle.param<int>("ros/queue_depth", _queueDepth, 100);
-    _nodeHandle.param<std::string>("connection/device_ip", _deviceIpStr,
-      "129.132.39.171");
-    _nodeHandle.param<int>("connection/device_port", _devicePort, 5602);
-    _nodeHandle.param<int>("connection/device_control_port", _deviceControlPort,
-      5601);
-    _nodeHandle.param<double>("connection/retry_timeout", _retryTimeout, 1);
-    _nodeHandle.param<double>("diagnostics/vns_min_freq", _vnsMinFreq, 80);
-    _nodeHandle.param<double>("diagnostics/vns_max_freq", _vnsMaxFreq, 120);
-    _nodeHandle.param<double>("diagnostics/vnp_min_freq", _vnpMinFreq, 0.8);
-    _nodeHandle.param<double>("diagnostics/vnp_max_freq", _vnpMaxFreq, 1.2);
-    _nodeHandle.param<double>("diagnostics/dmi_min_freq", _dmiMinFreq, 80);
-    _nodeHandle.param<double>("diagnostics/dmi_max_freq", _dmiMaxFreq, 120);
+    _nodeHandle.param<int>("ros/queue_depth", parameters.mQueueDepth, 100);
+    _nodeHandle.param<std::string>("connection/device_ip",
+      parameters.mDeviceIpStr, "129.132.39.171");
+    _nodeHandle.param<int>("connection/device_port", parameters.mDevicePort,
+      5602);
+    _nodeHandle.param<int>("connection/device_control_port",
+      parameters.mDeviceControlPort, 5601);
+    _nodeHandle.param<double>("connection/retry_timeout",
+      parameters.mRetryTimeout, 1);
+    _nodeHandle.param<double>("connection/read_timeout",
+      parameters.mReadTimeout, 2.5);
+    _nodeHandle.param<int>("connection/read_buffer_size",
+      parameters.mReadBufferSize, 131072);
+    if (parameters.mReadBufferSize <
+        static_cast<int>(FramedTCPConnectionClient::maxFrameSize)) {
+      ROS_WARN_STREAM("connection/read_buffer_size raised to "
+        << FramedTCPConnectionClient::maxFrameSize << " to hold a packet");
+      parameters.mReadBufferSize = FramedTCPConnectionClient::maxFrameSize;
+    }
+    _nodeHandle.param<double>("diagnostics/vns_min_freq",
+      parameters.mVnsMinFreq, 80);
+    _nodeHandle.param<double>("diagnostics/vns_max_freq",
+      parameters.mVnsMaxFreq, 120);
+    _nodeHandle.param<double>("diagnostics/vnp_min_freq",
+      parameters.mVnpMinFreq, 0.8);
+    _nodeHandle.param<double>("diagnostics/vnp_max_freq",
+      parameters.mVnpMaxFreq, 1.2);
+    _nodeHandle.param<double>("diagnostics/dmi_min_freq",
+      parameters.mDmiMinFreq, 80);
+    _nodeHandle.param<double>("diagnostics/dmi_max_freq",
+      parameters.mDmiMaxFreq, 120);
+    _nodeHandle.param<int>("quality/window_size",
+      parameters.mQualityWindowSize, 100);
+    _nodeHandle.param<int>("quality/performance_window_size",
+      parameters.mQualityPerformanceWindowSize, 30);
+    _nodeHandle.param<double>("quality/max_time_gap",
+      parameters.mQualityMaxTimeGap, 1);
+    _nodeHandle.param<double>("quality/max_heading_rate_residual",
+      parameters.mMaxHeadingRateResidual, 1);
+    _nodeHandle.param<double>("quality/max_velocity_residual",
+      parameters.mMaxVelocityResidual, 0.5);
+    _nodeHandle.param<double>("quality/max_acceleration_residual",
+      parameters.mMaxAccelerationResidual, 1);
+    _nodeHandle.param<double>("quality/max_rms_error_ratio",
+      parameters.mMaxRMSErrorRatio, 3);
+    _nodeHandle.param<bool>("logging/enable", parameters.mLoggingEnabled,
+      false);
+    _nodeHandle.param<std::string>("logging/directory",
+      parameters.mLoggingDirectory, "/tmp/poslv");
+    _nodeHandle.param<int>("logging/chunk_size", parameters.mLoggingChunkSize,
+      4096);
+    _nodeHandle.param<int>("logging/max_queued_chunks",
+      parameters.mLoggingMaxQueuedChunks, 16);
+    _nodeHandle.param<double>("logging/flush_period",
+      parameters.mLoggingFlushPeriod, 10);
+  }
+
+  bool PosLvNode::validateParameters(const Parameters& parameters,
+      std::string& message) {
+    std::stringstream stream;
+    if (parameters.mQueueDepth < 0)
+      stream << " ros/queue_depth must be non-negative;";
+    if (parameters.mDevicePort < 1 || parameters.mDevicePort > 65535)
+      stream << " connection/device_port must be in [1, 65535];";
+    if (parameters.mDeviceControlPort < 1 ||
+        parameters.mDeviceControlPort > 65535)
+      stream << " connection/device_control_port must be in [1, 65535];";
+    if (!(parameters.mRetryTimeout >= 0))
+      stream << " connection/retry_timeout must be non-negative;";
+    if (!(parameters.mReadTimeout > 0))
+      stream << " connection/read_timeout must be positive;";
+    if (!(parameters.mVnsMinFreq >= 0 &&
+        parameters.mVnsMinFreq <= parameters.mVnsMaxFreq))
+      stream << " diagnostics/vns_min_freq must be in [0, vns_max_freq];";
+    if (!(parameters.mVnpMinFreq >= 0 &&
+        parameters.mVnpMinFreq <= parameters.mVnpMaxFreq))
+      stream << " diagnostics/vnp_min_freq must be in [0, vnp_max_freq];";
+    if (!(parameters.mDmiMinFreq >= 0 &&
+        parameters.mDmiMinFreq <= parameters.mDmiMaxFreq))
+      stream << " diagnostics/dmi_min_freq must be in [0, dmi_max_freq];";
+    if (parameters.mQualityWindowSize < 1)
+      stream << " quality/window_size must be positive;";
+    if (parameters.mQualityPerformanceWindowSize < 1)
+      stream << " quality/performance_window_size must be positive;";
+    if (!(parameters.mQualityMaxTimeGap > 0))
+      stream << " quality/max_time_gap must be positive;";
+    if (!(parameters.mMaxHeadingRateResidual > 0) ||
+        !(parameters.mMaxVelocityResidual > 0) ||
+        !(parameters.mMaxAccelerationResidual > 0) ||
+        !(parameters.mMaxRMSErrorRatio > 0))
+      stream << " quality thresholds must be positive;";
+    if (parameters.mLoggingChunkSize < 1 ||
+        static_cast<size_t>(parameters.mLoggingChunkSize) >
+        ColumnarLogFormat::maxChunkRows)
+      stream << " logging/chunk_size must be in [1, "
+        << ColumnarLogFormat::maxChunkRows << "];";
+    if (parameters.mLoggingMaxQueuedChunks < 1)
+      stream << " logging/max_queued_chunks must be positive;";
+    if (!(parameters.mLoggingFlushPeriod > 0))
+      stream << " logging/flush_period must be positive;";
+    if (parameters.mLoggingEnabled && parameters.mLoggingDirectory.empty())
+      stream << " logging/directory must not be empty;";
+    message = stream.str();
+    if (message.empty())
+      return true;
+    // drop the leading space and the trailing separator
+    message = message.substr(1, message.size() - 2);
+    return false;
   }
 
 }
@@ -26,17 +26,22 @@
 
 #include <string>
 #include <memory>
+#include <thread>
 #include <unordered_map>
 
 #include <ros/ros.h>
 #include <diagnostic_updater/diagnostic_updater.h>
 
 #include "poslv/SetDGPS.h"
+#include "poslv/ReloadParameters.h"
+
+#include "NavigationQualityMonitor.h"
 
 class VehicleNavigationSolution;
 class VehicleNavigationPerformance;
 class TimeTaggedDMIData;
-class TCPConnectionClient;
+class Group;
+class POSLVComTCP;
 
 namespace diagnostic_updater {
   class HeaderlessTopicDiagnostic;
@@ -44,6 +49,9 @@ namespace diagnostic_updater {
 
 namespace poslv {
 
+  class FramedTCPConnectionClient;
+  class ColumnarLogWriter;
+
   /** The class PosLvNode implements the Applanix POSL LV node.
       \brief POS LV node
     */
@@ -76,6 +84,67 @@ namespace poslv {
       */
 
   protected:
+    /** \name Protected types
+      @{
+      */
+    /// Node parameters, read and validated before being applied
+    struct Parameters {
+      /// Frame ID
+      std::string mFrameId;
+      /// Queue depth
+      int mQueueDepth;
+      /// IP string
+      std::string mDeviceIpStr;
+      /// Port
+      int mDevicePort;
+      /// Control port
+      int mDeviceControlPort;
+      /// Retry timeout for TCP
+      double mRetryTimeout;
+      /// Timeout when waiting for TCP data
+      double mReadTimeout;
+      /// Size of the TCP read buffer
+      int mReadBufferSize;
+      /// Vehicle navigation solution minimum frequency
+      double mVnsMinFreq;
+      /// Vehicle navigation solution maximum frequency
+      double mVnsMaxFreq;
+      /// Vehicle navigation performance minimum frequency
+      double mVnpMinFreq;
+      /// Vehicle navigation performance maximum frequency
+      double mVnpMaxFreq;
+      /// Time-tagged DMI data minimum frequency
+      double mDmiMinFreq;
+      /// Time-tagged DMI data maximum frequency
+      double mDmiMaxFreq;
+      /// Window size for the navigation solution residuals
+      int mQualityWindowSize;
+      /// Window size for the navigation performance RMS errors
+      int mQualityPerformanceWindowSize;
+      /// Time gap after which differencing restarts
+      double mQualityMaxTimeGap;
+      /// Maximum RMS of the heading rate residual [deg/s]
+      double mMaxHeadingRateResidual;
+      /// Maximum RMS of the velocity residuals [m/s]
+      double mMaxVelocityResidual;
+      /// Maximum RMS of the acceleration residual [m/s^2]
+      double mMaxAccelerationResidual;
+      /// Maximum ratio of an RMS error to its window mean
+      double mMaxRMSErrorRatio;
+      /// Logging enabled
+      bool mLoggingEnabled;
+      /// Logging base directory
+      std::string mLoggingDirectory;
+      /// Number of rows per log chunk
+      int mLoggingChunkSize;
+      /// Maximum number of log chunks waiting to be written
+      int mLoggingMaxQueuedChunks;
+      /// Maximum age of a partial log chunk [s]
+      double mLoggingFlushPeriod;
+    };
+    /** @}
+      */
+
     /** \name Protected methods
       @{
       */
@@ -88,17 +157,53 @@ namespace poslv {
     /// Publishes the time-tagged DMI message
     void publishTimeTaggedDMIData(const ros::Time& timestamp,
       const TimeTaggedDMIData& dmi);
+    /// Publishes the navigation quality message
+    void publishNavigationQuality(const ros::Time& timestamp);
+    /// Checks the navigation quality against the thresholds
+    uint8_t checkNavigationQuality(std::string& message) const;
+    /// Opens the columnar log files
+    void initLogging();
+    /// Logs the vehicle navigation solution
+    void logVehicleNavigationSolution(const ros::Time& timestamp,
+      const VehicleNavigationSolution& vns);
+    /// Logs the vehicle navigation performance
+    void logVehicleNavigationPerformance(const ros::Time& timestamp,
+      const VehicleNavigationPerformance& vnp);
+    /// Logs the time-tagged DMI data
+    void logTimeTaggedDMIData(const ros::Time& timestamp,
+      const TimeTaggedDMIData& dmi);
+    /// Processes a group received from the device
+    void processGroup(const ros::Time& timestamp, const Group& group);
     /// Diagnose the TCP connection
     void diagnoseTCPConnection(diagnostic_updater::DiagnosticStatusWrapper&
       status);
     /// Diagnose system status
     void diagnoseSystemStatus(diagnostic_updater::DiagnosticStatusWrapper&
       status);
+    /// Diagnose navigation quality
+    void diagnoseNavigationQuality(diagnostic_updater::DiagnosticStatusWrapper&
+      status);
+    /// Diagnose logging
+    void diagnoseLogging(diagnostic_updater::DiagnosticStatusWrapper& status);
     /// Retrieves parameters
-    void getParameters();
+    void getParameters(Parameters& parameters) const;
+    /// Checks parameters, returns false and the reason if they are invalid
+    static bool validateParameters(const Parameters& parameters,
+      std::string& message);
     /// Set DGPS service
     bool setDgps(poslv::SetDGPS::Request& request, poslv::SetDGPS::Response&
       response);
+    /// Reload parameters service
+    bool reloadParameters(poslv::ReloadParameters::Request&,
+      poslv::ReloadParameters::Response& response);
+    /// Advertises the publishers
+    void advertisePublishers();
+    /// Configures the navigation quality monitor
+    void configureQualityMonitor();
+    /// Opens the device connection, replacing the current one
+    void connect();
+    /// Closes the log writer in the background so that spin() does not wait
+    void retireLogWriter();
     /** @}
       */
 
@@ -113,46 +218,38 @@ namespace poslv {
     ros::Publisher _vehicleNavigationPerformancePublisher;
     /// Time-tagged DMI data publisher
     ros::Publisher _timeTaggedDMIDataPublisher;
+    /// Navigation quality publisher
+    ros::Publisher _navigationQualityPublisher;
     /// Corrections protocol service
     ros::ServiceServer _setDgpsService;
-    /// Frame ID
-    std::string _frameId;
-    /// IP string
-    std::string _deviceIpStr;
-    /// Port
-    int _devicePort;
+    /// Reload parameters service
+    ros::ServiceServer _reloadParametersService;
+    /// Parameters, the frequency diagnostics point to their limits
+    Parameters _parameters;
     /// TCP connection
-    std::shared_ptr<TCPConnectionClient> _tcpConnection;
-    /// Retry timeout for TCP
-    double _retryTimeout;
+    std::shared_ptr<FramedTCPConnectionClient> _tcpConnection;
+    /// Device
+    std::shared_ptr<POSLVComTCP> _device;
+    /// Number of packets parsed in the last batch
+    size_t _lastBatchSize;
+    /// Parse time of the last batch
+    double _lastBatchParseTime;
+    /// Maximum parse time of a batch
+    double _maxBatchParseTime;
     /// Diagnostic updater
     diagnostic_updater::Updater _updater;
     /// Frequency diagnostic for vehicle navigation solution
     std::shared_ptr<diagnostic_updater::HeaderlessTopicDiagnostic> _vnsFreq;
-    /// Vehicle navigation solution minimum frequency
-    double _vnsMinFreq;
-    /// Vehicle navigation solution maximum frequency
-    double _vnsMaxFreq;
     /// Frequency diagnostic for vehicle navigation performance
     std::shared_ptr<diagnostic_updater::HeaderlessTopicDiagnostic> _vnpFreq;
-    /// Vehicle navigation performance minimum frequency
-    double _vnpMinFreq;
-    /// Vehicle navigation performance maximum frequency
-    double _vnpMaxFreq;
     /// Frequency diagnostic for time-tagged DMI data
     std::shared_ptr<diagnostic_updater::HeaderlessTopicDiagnostic> _dmiFreq;
-    /// Time-tagged DMI data minimum frequency
-    double _dmiMinFreq;
-    /// Time-tagged DMI data maximum frequency
-    double _dmiMaxFreq;
     /// Alignement status
     uint8_t _alignStatus;
     /// Navigation solution status for primary GPS
     int8_t _navStatus1;
     /// Navigation solution status for secondary GPS
     int8_t _navStatus2;
-    /// Queue depth
-    int _queueDepth;
     /// Vehicle navigation solution packet counter
     long _vnsPacketCounter;
     /// Vehicle navigation performance packet counter
@@ -215,8 +312,20 @@ namespace poslv {
     size_t _rtcm18Count;
     /// Received RTCM19 count
     size_t _rtcm19Count;
-    /// Control port
-    int _deviceControlPort;
+    /// Navigation quality monitor
+    NavigationQualityMonitor _qualityMonitor;
+    /// Navigation quality packet counter
+    long _qualityPacketCounter;
+    /// Columnar log writer
+    std::shared_ptr<ColumnarLogWriter> _logWriter;
+    /// Thread closing the previous log writer
+    std::thread _logWriterTeardown;
+    /// Vehicle navigation solution log table
+    size_t _vnsLogTable;
+    /// Vehicle navigation performance log table
+    size_t _vnpLogTable;
+    /// Time-tagged DMI data log table
+    size_t _dmiLogTable;
     /** @}
       */
 
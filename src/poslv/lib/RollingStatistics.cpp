@@ -0,0 +1,137 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+#include "RollingStatistics.h"
+
+#include <cmath>
+
+namespace poslv {
+
+/******************************************************************************/
+/* Constructors and Destructor                                                */
+/******************************************************************************/
+
+  RollingStatistics::RollingStatistics(size_t windowSize) :
+      _samples(windowSize ? windowSize : 1),
+      _head(0),
+      _numSamples(0),
+      _sum(0),
+      _squaredSum(0),
+      _numRejectedSamples(0),
+      _numSamplesSinceRejection(0) {
+  }
+
+  RollingStatistics::~RollingStatistics() {
+  }
+
+/******************************************************************************/
+/* Accessors                                                                  */
+/******************************************************************************/
+
+  size_t RollingStatistics::getWindowSize() const {
+    return _samples.size();
+  }
+
+  void RollingStatistics::setWindowSize(size_t windowSize) {
+    _samples.assign(windowSize ? windowSize : 1, 0);
+    clear();
+  }
+
+  size_t RollingStatistics::getNumSamples() const {
+    return _numSamples;
+  }
+
+  double RollingStatistics::getLast() const {
+    if (!_numSamples)
+      return 0;
+    return _samples[(_head + _samples.size() - 1) % _samples.size()];
+  }
+
+  double RollingStatistics::getMean() const {
+    if (!_numSamples)
+      return 0;
+    return _sum / _numSamples;
+  }
+
+  double RollingStatistics::getVariance() const {
+    if (!_numSamples)
+      return 0;
+    const double mean = getMean();
+    const double variance = _squaredSum / _numSamples - mean * mean;
+    return variance > 0 ? variance : 0;
+  }
+
+  double RollingStatistics::getRMS() const {
+    if (!_numSamples)
+      return 0;
+    const double meanSquare = _squaredSum / _numSamples;
+    return meanSquare > 0 ? std::sqrt(meanSquare) : 0;
+  }
+
+  size_t RollingStatistics::getNumRejectedSamples() const {
+    return _numRejectedSamples;
+  }
+
+  bool RollingStatistics::hasRejectedSamples() const {
+    return _numRejectedSamples &&
+      _numSamplesSinceRejection < _samples.size();
+  }
+
+/******************************************************************************/
+/* Methods                                                                    */
+/******************************************************************************/
+
+  void RollingStatistics::addSample(double value) {
+    if (!std::isfinite(value)) {
+      _numRejectedSamples++;
+      _numSamplesSinceRejection = 0;
+      return;
+    }
+    _numSamplesSinceRejection++;
+    if (_numSamples == _samples.size()) {
+      const double oldest = _samples[_head];
+      _sum -= oldest;
+      _squaredSum -= oldest * oldest;
+    }
+    else
+      _numSamples++;
+    _samples[_head] = value;
+    _sum += value;
+    _squaredSum += value * value;
+    _head = (_head + 1) % _samples.size();
+    // resum once per window to bound the round-off drift of the running sums
+    if (!_head && _numSamples == _samples.size()) {
+      _sum = 0;
+      _squaredSum = 0;
+      for (auto it = _samples.cbegin(); it != _samples.cend(); ++it) {
+        _sum += *it;
+        _squaredSum += *it * *it;
+      }
+    }
+  }
+
+  void RollingStatistics::clear() {
+    _head = 0;
+    _numSamples = 0;
+    _sum = 0;
+    _squaredSum = 0;
+    _numRejectedSamples = 0;
+    _numSamplesSinceRejection = 0;
+  }
+
+}
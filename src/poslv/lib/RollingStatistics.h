@@ -0,0 +1,113 @@
+/******************************************************************************
+ * Copyright (C) 2013 by Jerome Maye                                          *
+ * jerome.maye@gmail.com                                                      *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or modify       *
+ * it under the terms of the Lesser GNU General Public License as published by*
+ * the Free Software Foundation; either version 3 of the License, or          *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * Lesser GNU General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the Lesser GNU General Public License   *
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.       *
+ ******************************************************************************/
+
+/** \file RollingStatistics.h
+    \brief This file defines the RollingStatistics class which computes
+           statistics over a sliding window.
+  */
+
+#ifndef ROLLING_STATISTICS_H
+#define ROLLING_STATISTICS_H
+
+#include <cstddef>
+
+#include <vector>
+
+namespace poslv {
+
+  /** The class RollingStatistics keeps the last samples in a ring buffer and
+      updates their mean and variance in constant time per sample. Non-finite
+      samples are rejected and counted, they would poison the running sums.
+      \brief Rolling statistics
+    */
+  class RollingStatistics {
+  public:
+    /** \name Constructors/destructor
+      @{
+      */
+    /// Constructor
+    RollingStatistics(size_t windowSize = 100);
+    /// Copy constructor
+    RollingStatistics(const RollingStatistics& other) = default;
+    /// Copy assignment operator
+    RollingStatistics& operator = (const RollingStatistics& other) = default;
+    /// Destructor
+    virtual ~RollingStatistics();
+    /** @}
+      */
+
+    /** \name Accessors
+      @{
+      */
+    /// Returns the window size
+    size_t getWindowSize() const;
+    /// Sets the window size, this clears the samples
+    void setWindowSize(size_t windowSize);
+    /// Returns the number of samples in the window
+    size_t getNumSamples() const;
+    /// Returns the last sample
+    double getLast() const;
+    /// Returns the mean of the window
+    double getMean() const;
+    /// Returns the variance of the window
+    double getVariance() const;
+    /// Returns the root mean square of the window
+    double getRMS() const;
+    /// Returns the number of non-finite samples rejected
+    size_t getNumRejectedSamples() const;
+    /// Returns whether a sample was rejected within the last window
+    bool hasRejectedSamples() const;
+    /** @}
+      */
+
+    /** \name Methods
+      @{
+      */
+    /// Adds a finite sample, dropping the oldest one if the window is full
+    void addSample(double value);
+    /// Clears the samples
+    void clear();
+    /** @}
+      */
+
+  protected:
+    /** \name Protected members
+      @{
+      */
+    /// Ring buffer of samples
+    std::vector<double> _samples;
+    /// Position of the next sample
+    size_t _head;
+    /// Number of samples in the window
+    size_t _numSamples;
+    /// Sum of the samples
+    double _sum;
+    /// Sum of the squared samples
+    double _squaredSum;
+    /// Number of non-finite samples rejected
+    size_t _numRejectedSamples;
+    /// Number of samples added since the last rejected one
+    size_t _numSamplesSinceRejection;
+    /** @}
+      */
+
+  };
+
+}
+
+#endif // ROLLING_STATISTICS_H